@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+
+#include "dytools/io.h"
+#include "dytools/dict.h"
+#include "dytools/char_dict.h"
+#include "dytools/thread_pool.h"
+#include "dytools/data/conll.h"
+#include "dytools/data/binary_corpus.h"
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        std::cerr
+            << "usage: " << argv[0] << " MODEL_PATH DATA_PATH OUTPUT_PATH\n"
+            << "Converts a CoNLL file to the binary corpus format, using the dictionnaries of the model.\n";
+        return 1;
+    }
+    std::string model_path(argv[1]);
+    std::string data_path(argv[2]);
+    std::string output_path(argv[3]);
+
+
+    std::cerr << "Reading dictionnaries..." << std::endl;
+    dytools::Dict token_dict;
+    dytools::CharDict char_dict;
+    dytools::Dict tag_dict;
+    dytools::Dict label_dict;
+    {
+        dytools::TextFileLoader in(model_path + ".settings");
+
+        // same order as in dep-parser-train
+        in.load(token_dict);
+        in.load(char_dict);
+        in.load(tag_dict);
+        in.load(label_dict);
+
+        in.close();
+    }
+    token_dict.freeze();
+    tag_dict.freeze();
+    label_dict.freeze();
+
+
+    std::cerr << "Reading data..." << std::endl;
+    std::vector<dytools::ConllSentence> data;
+    dytools::read(data_path, data, dytools::get_default_thread_pool());
+
+
+    std::cerr << "Writing binary corpus..." << std::endl;
+    dytools::write_binary_corpus(output_path, data, token_dict, char_dict, tag_dict, label_dict);
+
+    return 0;
+}
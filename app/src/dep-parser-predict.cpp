@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <unistd.h>
 #include <string>
 
@@ -7,6 +9,8 @@
 
 #include "dytools/networks/dependency.h"
 #include "dytools/io.h"
+#include "dytools/model_bundle.h"
+#include "dytools/utils.h"
 #include "dytools/algorithms/tagger.h"
 #include "dytools/algorithms/dependency-parser.h"
 
@@ -14,26 +18,59 @@ int main(int argc, char** argv)
 {
     // initialize dynet and read cmd line args
     dynet::initialize(argc, argv);
-    if (argc != 3)
+    auto decoder = dytools::DependencyDecoder::NonProjective;
+    opterr = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "p")) != -1)
     {
-        std::cerr << "usage: " << argv[0] << " MODEL_PATH DATA_PATH\n";
+        switch (opt)
+        {
+            case 'p':
+                decoder = dytools::DependencyDecoder::Projective;
+                break;
+            case '?':
+            default:
+                optind = argc + 1; // force the usage message
+        }
+    }
+    if (argc - optind != 2)
+    {
+        std::cerr
+            << "usage: " << argv[0] << " [-p] MODEL_PATH DATA_PATH\n"
+            << "MODEL_PATH is either a model bundle or the path given to the training script\n"
+            << " -p\tprojective decoding\n";
         return 1;
     }
-    std::string model_path(argv[1]);
-    std::string data_path(argv[2]);
+    std::string model_path(argv[optind]);
+    std::string data_path(argv[optind + 1]);
 
 
 
-    std::cerr << "Reading data..." << std::endl;
-    std::vector<dytools::ConllSentence> data;
-    dytools::read(data_path, data);
+    // sentences are prefetched in the background while the network is loaded
+    dytools::ConllReader reader(data_path);
 
 
     std::cerr << "Reading network settings..." << std::endl;
     auto token_dict = std::make_shared<dytools::Dict>();
-    auto char_dict = std::make_shared<dytools::Dict>();
+    auto char_dict = std::make_shared<dytools::CharDict>();
     auto tag_dict = std::make_shared<dytools::Dict>();
     dytools::DependencySettings network_settings;
+    std::unique_ptr<dytools::ModelBundleLoader> bundle;
+    if (dytools::is_model_bundle(model_path))
+    {
+        bundle.reset(new dytools::ModelBundleLoader(model_path));
+
+        // read dictionnaries, the label dictionnary is not used for prediction
+        dytools::Dict label_dict;
+        bundle->load(*token_dict);
+        bundle->load(*char_dict);
+        bundle->load(*tag_dict);
+        bundle->load(label_dict);
+
+        // read network settings
+        bundle->load(network_settings);
+    }
+    else
     {
         dytools::TextFileLoader in(model_path + ".settings");
 
@@ -47,6 +84,9 @@ int main(int argc, char** argv)
 
         in.close();
     }
+    // dictionnaries are read-only from now on, use the faster lookup
+    token_dict->freeze();
+    tag_dict->freeze();
 
 
     std::cerr << "Building network..." << std::endl;
@@ -56,6 +96,12 @@ int main(int argc, char** argv)
 
 
     std::cerr << "Loading network parameters..." << std::endl;
+    if (bundle)
+    {
+        bundle->populate(network.local_pc);
+        bundle.reset();
+    }
+    else
     {
         dynet::TextFileLoader s(model_path);
         s.populate(network.local_pc);
@@ -63,29 +109,63 @@ int main(int argc, char** argv)
 
 
     std::cerr << "Decoding..." << std::endl;
-    for (auto& sentence : data)
+    auto& pool = dytools::get_default_thread_pool();
+    dytools::ConllWriter writer(std::cout);
+    const unsigned batch_size = 32u;
+    std::vector<dytools::ConllSentence> data;
+    dytools::ConllSentence next_sentence;
+    while (true)
     {
+        data.clear();
+        while (data.size() < batch_size && reader.next(next_sentence))
+            data.push_back(std::move(next_sentence));
+        if (data.empty())
+            break;
+
         dynet::ComputationGraph cg;
         network.new_graph(cg);
 
-        const auto p_logis = network.logits(sentence);
-        const auto e_tag_weights = p_logis.first;
-        const auto e_arc_weights = p_logis.second;
-
-        const auto last = e_arc_weights.i > e_tag_weights.i ? e_arc_weights : e_tag_weights;
+        std::vector<dynet::Expression> e_tag_weights;
+        std::vector<dynet::Expression> e_arc_weights;
+        dynet::Expression last;
+        for (const auto& sentence : data)
+        {
+            const auto p_logis = network.logits(sentence);
+            e_tag_weights.push_back(p_logis.first);
+            e_arc_weights.push_back(p_logis.second);
+
+            // nodes of the last sentence are the last ones of the graph
+            last = p_logis.second.i > p_logis.first.i ? p_logis.second : p_logis.first;
+        }
         cg.forward(last);
-        const auto v_tag_weights = as_vector(cg.get_value(e_tag_weights));
-        const auto v_arc_weights = as_vector(cg.get_value(e_arc_weights));
-
-        // decode tags
-        const auto tags = dytools::tagger(sentence.size(), v_tag_weights);
-
-        // decode dependency tree
-        const auto heads = dytools::non_projective_dependency_parser(sentence.size(), v_arc_weights);
 
-        // update and print the data
-        sentence.update_tags(tags);
-        sentence.update_heads(heads);
+        // scores are read in place from the computation graph (only copied when they live on a GPU)
+        std::vector<unsigned> sizes;
+        std::vector<std::vector<float>> arc_buffers(data.size());
+        std::vector<float> tag_buffer;
+        std::vector<const float*> p_arc_weights;
+        for (unsigned i = 0u ; i < data.size() ; ++i)
+        {
+            auto& sentence = data.at(i);
+            sizes.push_back(sentence.size());
+            p_arc_weights.push_back(dytools::as_score_matrix(cg.get_value(e_arc_weights.at(i)), arc_buffers.at(i)).data);
+
+            // decode tags
+            const auto tag_weights = dytools::as_score_matrix(cg.get_value(e_tag_weights.at(i)), tag_buffer);
+            const auto tags = dytools::tagger(tag_weights);
+            sentence.update_tags(tags);
+        }
+
+        // decode dependency trees
+        std::vector<std::vector<unsigned>> heads;
+        dytools::dependency_parser(decoder, sizes, p_arc_weights, heads, pool);
+
+        // update the data and write it while the next batch is decoded
+        for (unsigned i = 0u ; i < data.size() ; ++i)
+        {
+            data.at(i).update_heads(heads.at(i));
+            writer.write(std::move(data.at(i)));
+        }
     }
-    dytools::write(std::cout, data);
-}
\ No newline at end of file
+    writer.close();
+}
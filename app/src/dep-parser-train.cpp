@@ -7,6 +7,8 @@
 #include "dytools/training.h"
 #include "dytools/networks/dependency.h"
 #include "dytools/io.h"
+#include "dytools/model_bundle.h"
+#include "dytools/data/conll_dicts.h"
 
 bool read_command_line_args(int& argc, char**& argv, dytools::TrainingSettings& training_settings, dytools::DependencySettings& network_settings, std::string& train_path, std::string& dev_path);
 void command_line_help(std::ostream& os, const std::string name);
@@ -33,23 +35,22 @@ int main(int argc, char** argv)
     std::cerr << "Reading data..." << std::endl;
     std::vector<dytools::ConllSentence> train_data;
     std::vector<dytools::ConllSentence> dev_data;
-    dytools::read(train_path, train_data);
+    dytools::read(train_path, train_data, dytools::get_default_thread_pool());
     if (dev_path.size() > 0)
-        dytools::read(dev_path, dev_data);
+        dytools::read(dev_path, dev_data, dytools::get_default_thread_pool());
     else
         std::cerr << "WARNING: no validation data!" << std::endl;
 
 
     std::cerr << "Building dictionnariess..." << std::endl;
-    dytools::DictSettings voc_settings;
-    voc_settings.num_word = "*NUM*";
-    voc_settings.unk_word = "*UNK*";
-    voc_settings.lowercase = true;
-    auto token_dict = dytools::build_conll_token_dict(voc_settings, train_data.begin(), train_data.end());
-    auto char_dict = dytools::build_conll_char_dict(voc_settings, train_data.begin(), train_data.end());
-
-    auto tag_dict = dytools::build_conll_tag_dict(train_data.begin(), train_data.end());
-    auto label_dict = dytools::build_conll_label_dict(train_data.begin(), train_data.end());
+    dytools::ConllDictSettings dict_settings;
+    dict_settings.lowercase = true;
+    dict_settings.has_num = true;
+    const auto dicts = dytools::build_conll_dicts(train_data, dict_settings, dytools::get_default_thread_pool());
+    auto token_dict = dicts.token_dict;
+    auto char_dict = dicts.char_dict;
+    auto tag_dict = dicts.tag_dict;
+    auto label_dict = dicts.label_dict;
 
     std::cerr << "Saving network settings..." << std::endl;
     {
@@ -78,6 +79,25 @@ int main(int argc, char** argv)
     trainer.optimize_supervised(optimizer, train_data, dev_data);
 
 
+    if (training_settings.model_path.size() > 0)
+    {
+        std::cerr << "Saving model bundle..." << std::endl;
+
+        // parameters of the best epoch
+        trainer.load();
+
+        // same order as the settings file
+        dytools::ModelBundleWriter out;
+        out.save(*token_dict);
+        out.save(*char_dict);
+        out.save(*tag_dict);
+        out.save(*label_dict);
+        out.save(network_settings);
+        out.save_parameters(network->local_pc);
+        out.write(training_settings.model_path + ".bundle");
+    }
+
+
     std::cerr << "Done!" << std::endl;
     return 0;
 }
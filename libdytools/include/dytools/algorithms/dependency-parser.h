@@ -2,11 +2,201 @@
 
 #include <vector>
 
+#include "dytools/algorithms/score-matrix.h"
+#include "dytools/thread_pool.h"
+
 namespace dytools
 {
 
+enum struct DependencyDecoder
+{
+    NonProjective,
+    Projective
+};
+
+enum struct NonProjectiveAlgorithm
+{
+    ChuLiuEdmonds, // recursive O(n^3) implementation from AD3
+    Tarjan // iterative O(n^2) implementation on a dense score matrix
+};
+
+/**
+ * Buffers used by RunTarjan.
+ * They are only resized, never shrunk, so a workspace that is reused across calls
+ * does not allocate anymore once it has seen the longest sentence.
+ */
+struct ArborescenceWorkspace
+{
+    // dense (contracted) graph, indexed by "slots": head + mod * length
+    std::vector<float> weights;
+    std::vector<int> edge_head;
+    std::vector<int> edge_mod;
+
+    // per slot
+    std::vector<float> best_weight;
+    std::vector<int> slot_id;
+    std::vector<char> state;
+    std::vector<char> active;
+    std::vector<char> in_cycle;
+    std::vector<int> path;
+    std::vector<int> cycle;
+
+    // per node of the contraction forest (original vertices and contracted cycles)
+    std::vector<int> parent;
+    std::vector<int> in_head;
+    std::vector<int> in_mod;
+    std::vector<int> children_begin;
+    std::vector<int> children_end;
+    std::vector<int> children;
+    std::vector<int> stack;
+    std::vector<int> entry;
+    std::vector<char> kept;
+
+    // only used by the k-best decoder
+    std::vector<float> second_weights;
+
+    std::vector<int> heads;
+
+    void resize(const unsigned length);
+    // only the buffers of the contraction forest, i.e. everything that is not indexed by slots
+    void resize_forest(const unsigned length);
+};
+
+/**
+ * Buffers used by RunPrunedTarjan, same reuse policy as ArborescenceWorkspace.
+ * Memory is linear in the number of kept arcs: the O(length^2) buffers of tarjan
+ * are only allocated when a sentence falls back to the dense decoder.
+ */
+struct SparseArborescenceWorkspace
+{
+    ArborescenceWorkspace tarjan;
+
+    // candidate incoming arcs of each node of the contraction forest,
+    // stored in [candidates_begin[id], candidates_end[id]) of the flat arrays
+    std::vector<int> candidates_begin;
+    std::vector<int> candidates_end;
+    std::vector<int> candidate_head;
+    std::vector<int> candidate_mod;
+    std::vector<float> candidate_weight;
+
+    // union-find over the nodes of the contraction forest
+    std::vector<int> representative;
+    // per node of the contraction forest
+    std::vector<char> state;
+    std::vector<float> best_weight;
+
+    std::vector<int> order;
+    std::vector<char> root_in_top_k;
+
+    void resize(const unsigned length, const unsigned top_k);
+};
+
+std::vector<unsigned> non_projective_dependency_parser(
+        const unsigned size,
+        const std::vector<float>& arc_weights,
+        const NonProjectiveAlgorithm algorithm = NonProjectiveAlgorithm::Tarjan
+);
+
+/**
+ * Allocation-free version (after warm-up of the workspace and of the output vector).
+ * @param size number of words in the sentence (without the root)
+ * @param arc_weights (size+1)x(size+1) matrix, head + mod * (size + 1)
+ * @param workspace
+ * @param output heads, using the same convention as the other overload
+ */
+void non_projective_dependency_parser(
+        const unsigned size,
+        const float* arc_weights,
+        ArborescenceWorkspace& workspace,
+        std::vector<unsigned>& output
+);
+
+/**
+ * Reads the arc weights in place, e.g. directly from the memory of a dynet::Tensor.
+ * @param arc_weights (size+1)x(size+1) matrix, the weight of arc head -> mod is arc_weights(head, mod),
+ *                    it must be contiguous
+ * @param workspace
+ * @param output
+ */
+void non_projective_dependency_parser(
+        const ScoreMatrix& arc_weights,
+        ArborescenceWorkspace& workspace,
+        std::vector<unsigned>& output
+);
+
+/**
+ * Decode a batch of sentences in parallel, longest sentences are scheduled first.
+ * @param sizes number of words of each sentence (without the root)
+ * @param arc_weights pointer to the (size+1)x(size+1) arc weights of each sentence
+ * @param output heads of each sentence, in input order
+ * @param pool
+ */
+void non_projective_dependency_parser(
+        const std::vector<unsigned>& sizes,
+        const std::vector<const float*>& arc_weights,
+        std::vector<std::vector<unsigned>>& output,
+        ThreadPool& pool
+);
+
+std::vector<unsigned> projective_dependency_parser(const unsigned size, const std::vector<float>& arc_weights);
+void projective_dependency_parser(const unsigned size, const float* arc_weights, std::vector<unsigned>& output);
+void projective_dependency_parser(
+        const std::vector<unsigned>& sizes,
+        const std::vector<const float*>& arc_weights,
+        std::vector<std::vector<unsigned>>& output,
+        ThreadPool& pool
+);
+
+/**
+ * Non-projective decoding on a pruned graph where only the top_k heads of each word are kept,
+ * plus an arc from the root so that the graph always contains a tree.
+ * The result is exact whenever the best tree is in the pruned graph.
+ * If the best tree of the pruned graph uses one of the additional root arcs,
+ * the pruning was probably too aggressive for this sentence: it is decoded
+ * again with the dense decoder and the function returns false.
+ * @param size number of words in the sentence (without the root)
+ * @param arc_weights (size+1)x(size+1) matrix, head + mod * (size + 1)
+ * @param top_k number of candidate heads per word
+ * @param workspace
+ * @param output
+ * @return false if the dense decoder was used
+ */
+bool pruned_non_projective_dependency_parser(
+        const unsigned size,
+        const float* arc_weights,
+        const unsigned top_k,
+        SparseArborescenceWorkspace& workspace,
+        std::vector<unsigned>& output
+);
+
+struct ScoredDependencyTree
+{
+    std::vector<unsigned> heads;
+    float score;
+};
+
+/**
+ * k-best non-projective decoding, trees are sorted by decreasing score.
+ * Less than k trees are returned if the graph does not contain k spanning trees.
+ * @param size number of words in the sentence (without the root)
+ * @param arc_weights (size+1)x(size+1) matrix, head + mod * (size + 1)
+ * @param k
+ * @return
+ */
+std::vector<ScoredDependencyTree> k_best_non_projective_dependency_parser(
+        const unsigned size,
+        const std::vector<float>& arc_weights,
+        const unsigned k
+);
 
-std::vector<unsigned> non_projective_dependency_parser(const unsigned size, const std::vector<float>& arc_weights);
+// dispatch to one of the batch decoders above
+void dependency_parser(
+        const DependencyDecoder decoder,
+        const std::vector<unsigned>& sizes,
+        const std::vector<const float*>& arc_weights,
+        std::vector<std::vector<unsigned>>& output,
+        ThreadPool& pool
+);
 
 
 void RunCLE(
@@ -25,4 +215,82 @@ void RunChuLiuEdmondsIteration(
         float *value
 );
 
-}
\ No newline at end of file
+/**
+ * Maximum spanning arborescence rooted at vertex 0 in O(n^2).
+ * Same input and output conventions as RunCLE.
+ * @param length number of vertices, including the root
+ * @param scores dense matrix, head + mod * length
+ * @param workspace
+ * @param heads
+ * @param value
+ */
+void RunTarjan(
+        const unsigned length,
+        const float* scores,
+        ArborescenceWorkspace* workspace,
+        std::vector<int> *heads,
+        float *value
+);
+
+/**
+ * Tarjan's algorithm on the graph restricted to the top_k incoming arcs of each vertex
+ * (and the arc from the root), stored as compact candidate lists.
+ * The candidate lists of the vertices of a cycle are merged when it is contracted,
+ * so the cost depends on the number of kept arcs rather than on length^2
+ * (except for the selection of the candidates).
+ * @param length number of vertices, including the root
+ * @param scores dense matrix, head + mod * length
+ * @param top_k
+ * @param workspace
+ * @param heads
+ * @param value
+ * @return true if the tree uses a root arc that is not in the top_k candidates of its modifier
+ */
+bool RunPrunedTarjan(
+        const unsigned length,
+        const float* scores,
+        const unsigned top_k,
+        SparseArborescenceWorkspace* workspace,
+        std::vector<int> *heads,
+        float *value
+);
+
+/**
+ * k-best maximum spanning arborescences (Camerini et al., 1980).
+ * The search space is recursively split in two around the arc that must be removed
+ * to obtain the second best tree of a subproblem: the subproblem that includes this arc
+ * keeps its best tree, the best tree of the one that excludes it is the second best tree.
+ * The second best tree is found by replaying the contractions of RunTarjan,
+ * so each split costs O(n^2) instead of one constrained decoding per arc of the tree.
+ * @param length number of vertices, including the root
+ * @param scores dense matrix, head + mod * length, -inf weights are treated as missing arcs
+ * @param k
+ * @param heads
+ * @param values
+ */
+void RunKBestCamerini(
+        const unsigned length,
+        const float* scores,
+        const unsigned k,
+        std::vector<std::vector<int>> *heads,
+        std::vector<float> *values
+);
+
+/**
+ * First-order projective decoder (Eisner, 1996).
+ * Same input and output conventions as RunCLE.
+ * Complete spans are stored both row-major and column-major so that,
+ * for every chart item, the max over split points runs over two contiguous arrays.
+ * @param length number of vertices, including the root
+ * @param scores dense matrix, head + mod * length
+ * @param heads
+ * @param value
+ */
+void RunEisner(
+        const unsigned length,
+        const float* scores,
+        std::vector<int> *heads,
+        float *value
+);
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace dytools
+{
+
+/**
+ * Computes max_i (a[i] + b[i]) and the first index where it is reached.
+ * Both operands must be contiguous: the max is computed with SIMD instructions when available,
+ * then the argmax is recovered by a (usually short) scan, also vectorized.
+ * @param a
+ * @param b
+ * @param size
+ * @param argmax
+ * @return the max value
+ */
+inline float max_plus(const float* a, const float* b, const unsigned size, unsigned& argmax)
+{
+    float max_value = -std::numeric_limits<float>::infinity();
+    unsigned i = 0u;
+
+#if defined(__AVX__)
+    if (size >= 8u)
+    {
+        // two independent accumulators to hide the latency of the max instruction
+        __m256 lanes = _mm256_set1_ps(max_value);
+        __m256 lanes2 = lanes;
+        for (; i + 16u <= size ; i += 16u)
+        {
+            lanes = _mm256_max_ps(lanes, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            lanes2 = _mm256_max_ps(lanes2, _mm256_add_ps(_mm256_loadu_ps(a + i + 8u), _mm256_loadu_ps(b + i + 8u)));
+        }
+        if (i + 8u <= size)
+        {
+            lanes = _mm256_max_ps(lanes, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            i += 8u;
+        }
+        lanes = _mm256_max_ps(lanes, lanes2);
+
+        float v_lanes[8];
+        _mm256_storeu_ps(v_lanes, lanes);
+        for (unsigned l = 0u ; l < 8u ; ++l)
+            max_value = (v_lanes[l] > max_value ? v_lanes[l] : max_value);
+    }
+#endif
+
+    for (; i < size ; ++i)
+    {
+        const float v = a[i] + b[i];
+        max_value = (v > max_value ? v : max_value);
+    }
+
+    // the sums are recomputed exactly as above, so the max is found by an equality test
+    argmax = 0u;
+    unsigned j = 0u;
+
+#if defined(__AVX__)
+    const __m256 target = _mm256_set1_ps(max_value);
+    for (; j + 8u <= size ; j += 8u)
+    {
+        const __m256 v = _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+        const int mask = _mm256_movemask_ps(_mm256_cmp_ps(v, target, _CMP_EQ_OQ));
+        if (mask != 0)
+        {
+            argmax = j + (unsigned) __builtin_ctz(mask);
+            return max_value;
+        }
+    }
+#endif
+
+    for (; j < size ; ++j)
+    {
+        if (a[j] + b[j] == max_value)
+        {
+            argmax = j;
+            break;
+        }
+    }
+    return max_value;
+}
+
+/**
+ * Computes log sum_i exp(a[i] + b[i]), the max is factored out for numerical stability.
+ * @param a
+ * @param b
+ * @param size
+ * @return -inf if size is 0 or if all sums are -inf
+ */
+inline float log_sum_exp_plus(const float* a, const float* b, const unsigned size)
+{
+    unsigned argmax;
+    const float max_value = max_plus(a, b, size, argmax);
+    if (max_value == -std::numeric_limits<float>::infinity())
+        return max_value;
+
+    float sum = 0.f;
+    for (unsigned i = 0u ; i < size ; ++i)
+        sum += std::exp(a[i] + b[i] - max_value);
+    return max_value + std::log(sum);
+}
+
+}
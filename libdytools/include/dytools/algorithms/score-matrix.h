@@ -0,0 +1,43 @@
+#pragma once
+
+namespace dytools
+{
+
+/**
+ * Non-owning view over a column-major matrix of scores, e.g. the memory of a dynet::Tensor.
+ * Element (row, col) is data[row + col * stride]: stride is equal to the number of rows
+ * for a dense matrix, it is larger for a sub-matrix of a bigger one.
+ * The viewed memory must outlive the view.
+ */
+struct ScoreMatrix
+{
+    const float* data;
+    unsigned rows;
+    unsigned cols;
+    unsigned stride;
+
+    ScoreMatrix(const float* data, const unsigned rows, const unsigned cols) :
+        data(data), rows(rows), cols(cols), stride(rows)
+    {}
+
+    ScoreMatrix(const float* data, const unsigned rows, const unsigned cols, const unsigned stride) :
+        data(data), rows(rows), cols(cols), stride(stride)
+    {}
+
+    inline float operator()(const unsigned row, const unsigned col) const
+    {
+        return data[row + col * stride];
+    }
+
+    inline const float* col(const unsigned col) const
+    {
+        return data + col * stride;
+    }
+
+    inline bool contiguous() const
+    {
+        return stride == rows;
+    }
+};
+
+}
@@ -4,18 +4,93 @@
 #include <vector>
 #include <set>
 
+#include "dytools/algorithms/score-matrix.h"
+#include "dytools/thread_pool.h"
+
 namespace dytools
 {
 
 typedef std::pair<unsigned, unsigned> Span;
 typedef std::set<Span> Tree;
 
+/**
+ * Buffers used by the CKY chart, they are only resized, never shrunk.
+ */
+struct SpanParserWorkspace
+{
+    std::vector<float> row;
+    std::vector<float> col;
+    std::vector<unsigned> back_ptr;
+    std::vector<Span> stack;
+
+    // only used by span_inside_outside
+    std::vector<float> outside_row;
+    std::vector<float> outside_col;
+
+    void resize(const unsigned size);
+};
+
 /**
  * This parser do not return any unary constituent.
+ *
+ * If max_length is not 0, constituents that cover more than max_length words can only be
+ * suffixes of the sentence, i.e. spans (left, size-1), and the left child of such a span
+ * must cover at most max_length words. Long constituents therefore form a right-branching
+ * backbone, which always contains a valid tree, and decoding is in O(size * max_length^2).
  * @param size
  * @param weights
+ * @param max_length maximum number of words of a constituent outside of the backbone, 0 means no limit
+ * @return
+ */
+Tree binary_span_parser(const unsigned size, const std::vector<float> &weights, const unsigned max_length = 0u);
+
+/**
+ * Reads the scores in place, without copying them.
+ * @param weights size x size matrix, the weight of span (left, right) is weights(left, right)
+ * @param max_length see above
  * @return
  */
-Tree binary_span_parser(const unsigned size, const std::vector<float> &weights);
+Tree binary_span_parser(const ScoreMatrix& weights, const unsigned max_length = 0u);
+
+/**
+ * Allocation-free version (after warm-up of the workspace) with a flat output.
+ * The 2*size-1 spans of the binary tree, including the single-word ones,
+ * are written in pre-order: a span is followed by the spans of its left child, then of its right child.
+ * @param weights size x size matrix, the weight of span (left, right) is weights(left, right)
+ * @param workspace
+ * @param output must have room for 2*size-1 spans
+ * @param max_length see above
+ */
+void binary_span_parser(const ScoreMatrix& weights, SpanParserWorkspace& workspace, Span* output, const unsigned max_length = 0u);
+
+/**
+ * Decode a batch of sentences in parallel into a single buffer, longest sentences are scheduled first.
+ * The spans of sentence i are output[offsets[i]] to output[offsets[i+1] - 1], in the same order as above.
+ * @param sizes number of words of each sentence
+ * @param weights pointer to the size x size span weights of each sentence
+ * @param output
+ * @param offsets
+ * @param pool
+ * @param max_length see above
+ */
+void binary_span_parser(
+        const std::vector<unsigned>& sizes,
+        const std::vector<const float*>& weights,
+        std::vector<Span>& output,
+        std::vector<unsigned>& offsets,
+        ThreadPool& pool,
+        const unsigned max_length = 0u
+);
+
+/**
+ * Inside-outside algorithm over the same trees and weights as binary_span_parser
+ * (without length limit), i.e. single-word spans have a null weight.
+ * @param weights size x size matrix, the weight of span (left, right) is weights(left, right)
+ * @param workspace
+ * @param marginals if not null, the marginal probability of span (left, right) is written at
+ *                  marginals[left + right * weights.stride] (0 if left >= right)
+ * @return the log-partition function
+ */
+float span_inside_outside(const ScoreMatrix& weights, SpanParserWorkspace& workspace, float* marginals = nullptr);
 
-}
\ No newline at end of file
+}
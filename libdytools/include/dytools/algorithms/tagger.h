@@ -2,10 +2,19 @@
 
 #include <vector>
 
+#include "dytools/algorithms/score-matrix.h"
+
 namespace dytools
 {
 
 std::vector<unsigned> tagger(const unsigned size, const std::vector<float>& tag_weights);
 
+/**
+ * Reads the scores in place, without copying them.
+ * @param tag_weights n_tags x size matrix, one column per word
+ * @return
+ */
+std::vector<unsigned> tagger(const ScoreMatrix& tag_weights);
+
 
-}
\ No newline at end of file
+}
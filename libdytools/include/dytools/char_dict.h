@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+
+namespace dytools
+{
+
+/**
+ * Vocabulary of Unicode code points, words are decoded from UTF-8
+ * (invalid bytes are decoded as U+FFFD, the replacement character).
+ * ASCII characters are looked up in a direct table, other code points in an open-addressing table.
+ */
+struct CharDict
+{
+    // special symbols, outside of the Unicode range
+    static const std::uint32_t unk_symbol = 0x110000u;
+    static const std::uint32_t begin_symbol = 0x110001u;
+    static const std::uint32_t end_symbol = 0x110002u;
+
+    bool has_unk;
+    unsigned unk_id = 0u;
+
+    std::vector<std::uint32_t> id_to_code_point;
+
+    explicit CharDict(bool _has_unk=true);
+
+    void add(const std::uint32_t code_point);
+    // adds all the characters of the word
+    void add_word(const boost::string_ref& word);
+
+    unsigned to_id(const std::uint32_t code_point) const;
+    /**
+     * Converts a whole word in one pass, ASCII characters are not decoded.
+     * @param word UTF-8 string
+     * @param output cleared first, reusing it across calls avoids allocations
+     */
+    void to_ids(const boost::string_ref& word, std::vector<unsigned>& output) const;
+    std::vector<unsigned> to_ids(const boost::string_ref& word) const;
+
+    // UTF-8 encoding of the character
+    std::string to_string(const unsigned id) const;
+
+    // code points of a UTF-8 string, with the same decoding rules as the dictionary
+    static void decode(const boost::string_ref& word, std::vector<std::uint32_t>& output);
+
+    unsigned size() const;
+
+    // fingerprint of the vocabulary (with its ids)
+    std::uint64_t hash() const;
+
+    /**
+     * Models trained before CharDict stored characters in a Dict, without a class version.
+     * Such files are read with a version below 2 and rejected instead of being misread.
+     */
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        if (version < 2u)
+            throw std::runtime_error("The character dictionary was saved in the old format, the model must be rebuilt");
+
+        ar & has_unk;
+        ar & unk_id;
+        ar & id_to_code_point;
+
+        if (Archive::is_loading::value)
+            rebuild_tables();
+    }
+
+private:
+    struct Slot
+    {
+        std::uint32_t code_point;
+        std::uint32_t id;
+    };
+
+    std::array<std::uint32_t, 128u> ascii_ids;
+    std::vector<Slot> table; // power of two size, load factor of at most 1/2
+    unsigned n_non_ascii = 0u;
+
+    // returns the id or missing_id
+    std::uint32_t find(const std::uint32_t code_point) const;
+    void insert(const std::uint32_t code_point, const std::uint32_t id);
+    void rebuild_tables();
+};
+
+}
+
+BOOST_CLASS_VERSION(dytools::CharDict, 2)
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dytools/dict.h"
+#include "dytools/char_dict.h"
+#include "dytools/data/conll.h"
+#include "dytools/data/mapped_file.h"
+
+namespace dytools
+{
+
+/**
+ * Header of the binary corpus format.
+ * The file contains one column per field, all ids have already been converted with the dictionaries,
+ * so the file is only valid for dictionaries with the same hashes.
+ * Columns are aligned on 64 bytes and stored in host byte order:
+ *  - sentence_offsets: uint64 x (n_sentences + 1), index of the first token of each sentence
+ *  - tokens, tags, heads, labels: uint32 x n_tokens (heads use the same convention as ConllToken)
+ *  - char_offsets: uint64 x (n_tokens + 1), index of the first character of each token
+ *  - chars: uint32 x n_chars
+ */
+struct BinaryCorpusHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t n_sentences;
+    std::uint64_t n_tokens;
+    std::uint64_t n_chars;
+
+    std::uint64_t token_dict_hash;
+    std::uint64_t char_dict_hash;
+    std::uint64_t tag_dict_hash;
+    std::uint64_t label_dict_hash;
+
+    // byte offsets of the columns
+    std::uint64_t sentence_offsets;
+    std::uint64_t tokens;
+    std::uint64_t char_offsets;
+    std::uint64_t chars;
+    std::uint64_t tags;
+    std::uint64_t heads;
+    std::uint64_t labels;
+};
+
+/**
+ * View of a sentence of a BinaryCorpus, pointers are valid as long as the corpus is alive.
+ */
+struct BinarySentence
+{
+    unsigned n_words;
+    const std::uint32_t* tokens;
+    const std::uint32_t* tags;
+    const std::uint32_t* heads;
+    const std::uint32_t* labels;
+    // n_words + 1 entries, the characters of word i are chars[char_offsets[i]] ... chars[char_offsets[i + 1] - 1]
+    const std::uint64_t* char_offsets;
+    const std::uint32_t* chars;
+
+    inline unsigned size() const
+    {
+        return n_words;
+    }
+
+    // same layout as the inputs of EmbeddingsBuilder
+    std::vector<unsigned> token_ids() const;
+    std::vector<std::vector<unsigned>> char_ids() const;
+};
+
+/**
+ * Memory-mapped corpus in the binary format, nothing is parsed or converted at loading time.
+ * Only the offset columns are scanned once by the constructor, to check that the views they define are valid.
+ * Note that the networks still take ConllSentence as input: this is a storage format (and conll-to-binary
+ * the converter), training does not read it yet.
+ */
+struct BinaryCorpus
+{
+    explicit BinaryCorpus(const std::string& path);
+
+    BinaryCorpus(const BinaryCorpus&) = delete;
+    BinaryCorpus& operator=(const BinaryCorpus&) = delete;
+
+    // throws if the corpus was not built with these dictionaries
+    void check_dicts(const Dict& token_dict, const CharDict& char_dict, const Dict& tag_dict, const Dict& label_dict) const;
+
+    inline unsigned size() const
+    {
+        return header->n_sentences;
+    }
+
+    BinarySentence operator[](const unsigned i) const;
+    BinarySentence at(const unsigned i) const;
+
+private:
+    const MappedFile file;
+    const BinaryCorpusHeader* header;
+
+    const std::uint64_t* sentence_offsets;
+    const std::uint32_t* tokens;
+    const std::uint64_t* char_offsets;
+    const std::uint32_t* chars;
+    const std::uint32_t* tags;
+    const std::uint32_t* heads;
+    const std::uint32_t* labels;
+};
+
+/**
+ * Converts a corpus to the binary format.
+ * Characters are Unicode code points, decoded from UTF-8 by the CharDict.
+ * @param path
+ * @param data
+ * @param token_dict
+ * @param char_dict
+ * @param tag_dict
+ * @param label_dict
+ */
+void write_binary_corpus(
+        const std::string& path,
+        const std::vector<ConllSentence>& data,
+        const Dict& token_dict,
+        const CharDict& char_dict,
+        const Dict& tag_dict,
+        const Dict& label_dict
+);
+
+}
@@ -4,8 +4,18 @@
 #include <string>
 #include <iostream>
 #include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <boost/utility/string_ref.hpp>
 
 #include "dytools/dict.h"
+#include "dytools/char_dict.h"
+#include "dytools/data/mapped_file.h"
+#include "dytools/thread_pool.h"
 #include "dynet/expr.h"
 
 namespace dytools
@@ -37,9 +47,11 @@ struct ConllToken
     );
 };
 
+// getters work with both ConllToken and InternedConllToken
 struct ConllWordGetter
 {
-    inline const std::string& operator()(const ConllToken& token) const
+    template <class Token>
+    inline const std::string& operator()(const Token& token) const
     {
         return token.word;
     }
@@ -47,7 +59,8 @@ struct ConllWordGetter
 
 struct POSTagGetter
 {
-    inline const std::string& operator()(const ConllToken& token) const
+    template <class Token>
+    inline const std::string& operator()(const Token& token) const
     {
         return token.postag;
     }
@@ -59,6 +72,29 @@ struct ConllSentence : public std::vector<ConllToken>
     void update_heads(const std::vector<unsigned>& heads);
 };
 
+/**
+ * Same fields as ConllToken, but they point into a buffer (e.g. a MappedFile) instead of owning a copy.
+ */
+struct ConllTokenRef
+{
+    boost::string_ref word;
+    boost::string_ref lemma;
+    boost::string_ref cpostag;
+    boost::string_ref postag;
+    boost::string_ref feats;
+    unsigned head;
+    boost::string_ref deprel;
+    boost::string_ref phead;
+    boost::string_ref pdeprel;
+
+    ConllToken to_token() const;
+};
+
+struct ConllSentenceRef : public std::vector<ConllTokenRef>
+{
+    ConllSentence to_sentence() const;
+};
+
 dynet::Expression sentence_to_sparse_matrix(dynet::ComputationGraph &cg, const ConllSentence &sentence);
 
 float uas(const ConllSentence& sentence, const std::vector<unsigned>& heads, bool normalize);
@@ -67,40 +103,190 @@ void write(std::ostream& os, const ConllSentence& sentence);
 void write(std::ostream& os, const std::vector<ConllSentence>& data);
 unsigned read(const std::string&, std::vector<ConllSentence>& output);
 
+/**
+ * Zero-copy reader: the file is tokenized in place, the fields of the output tokens point into the mapping,
+ * so file must outlive output.
+ * Same conventions as the other overload (comments, multiword tokens and empty nodes are skipped).
+ * @param file
+ * @param output
+ * @return number of sentences read
+ */
+unsigned read(const MappedFile& file, std::vector<ConllSentenceRef>& output);
+
+/**
+ * Tokenizes the first sentence of [begin, end) in place (same conventions as read()),
+ * building block for readers that do not keep the whole corpus as ConllSentenceRef.
+ * @param begin
+ * @param end
+ * @param sentence tokens are appended to it
+ * @return the position after the sentence, or nullptr if there is no sentence left
+ */
+const char* read_sentence(const char* begin, const char* end, ConllSentenceRef& sentence);
+
+/**
+ * Parallel versions of the two readers above: the file is split into chunks at blank lines
+ * (i.e. sentence boundaries), chunks are parsed on the pool and sentences are appended in file order.
+ */
+unsigned read(const std::string& path, std::vector<ConllSentence>& output, ThreadPool& pool);
+unsigned read(const MappedFile& file, std::vector<ConllSentenceRef>& output, ThreadPool& pool);
+
+/**
+ * Streaming reader: the input is read by blocks and parsed on a background thread that stays
+ * at most capacity sentences ahead of the consumer, so memory does not depend on the input size.
+ * Any stream can be used, including pipes and the standard input.
+ * Same conventions as read().
+ */
+struct ConllReader
+{
+    struct iterator
+    {
+        typedef std::input_iterator_tag iterator_category;
+        typedef ConllSentence value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const ConllSentence* pointer;
+        typedef const ConllSentence& reference;
+
+        ConllReader* reader = nullptr;
+        ConllSentence sentence;
+
+        iterator() = default;
+        explicit iterator(ConllReader* reader);
+
+        iterator& operator++();
+
+        inline reference operator*() const
+        {
+            return sentence;
+        }
+
+        inline pointer operator->() const
+        {
+            return &sentence;
+        }
+
+        inline bool operator==(const iterator& other) const
+        {
+            return reader == other.reader;
+        }
+
+        inline bool operator!=(const iterator& other) const
+        {
+            return reader != other.reader;
+        }
+    };
+
+    explicit ConllReader(const std::string& path, const unsigned capacity = 1024u);
+    // the stream must outlive the reader
+    explicit ConllReader(std::istream& input, const unsigned capacity = 1024u);
+    ~ConllReader();
+
+    ConllReader(const ConllReader&) = delete;
+    ConllReader& operator=(const ConllReader&) = delete;
+
+    /**
+     * Waits for the next sentence.
+     * Errors of the background thread (e.g. an invalid line) are rethrown here.
+     * @param sentence
+     * @return false at the end of the file
+     */
+    bool next(ConllSentence& sentence);
+
+    // single pass: begin() must be called only once
+    inline iterator begin()
+    {
+        return iterator(this);
+    }
+
+    inline iterator end()
+    {
+        return iterator();
+    }
+
+private:
+    // only set when the reader opened the file itself
+    std::unique_ptr<std::istream> owned_input;
+    std::istream& input;
+    const unsigned capacity;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<ConllSentence> queue;
+    bool done = false;
+    bool stop = false;
+    std::exception_ptr error;
+
+    std::thread thread;
+
+    void produce();
+};
+
+/**
+ * Streaming writer: sentences are formatted and written on a background thread,
+ * at most capacity sentences are waiting in memory.
+ * The stream is flushed whenever the writer has nothing left to write,
+ * so output is available as soon as it is produced.
+ */
+struct ConllWriter
+{
+    explicit ConllWriter(std::ostream& os, const unsigned capacity = 1024u);
+    // waits for pending sentences, errors are ignored: call close() to check them
+    ~ConllWriter();
+
+    ConllWriter(const ConllWriter&) = delete;
+    ConllWriter& operator=(const ConllWriter&) = delete;
+
+    // waits if capacity sentences are already pending
+    void write(ConllSentence sentence);
+
+    // waits until all sentences are written, throws if the stream failed
+    void close();
+
+private:
+    std::ostream& os;
+    const unsigned capacity;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<ConllSentence> queue;
+    bool closed = false;
+    std::exception_ptr error;
+
+    std::thread thread;
+
+    void consume();
+};
+
+// the builders accept iterators over ConllSentence as well as over InternedConllSentence
+// unknown words are mapped to *UNK*
 template<class It>
-std::shared_ptr<dytools::Dict> build_conll_token_dict(const DictSettings& settings, It begin, It end)
+std::shared_ptr<dytools::Dict> build_conll_token_dict(const bool lowercase, const bool has_num, It begin, It end)
 {
-    auto dict = std::make_shared<dytools::Dict>(settings);
+    auto dict = std::make_shared<dytools::Dict>(lowercase, has_num, true);
     for(;begin != end; ++begin)
     {
-        const ConllSentence& sentence = *begin;
-        for (const ConllToken& token : sentence)
-            dict->convert(token.word);
+        const auto& sentence = *begin;
+        for (const auto& token : sentence)
+            dict->add(token.word);
     }
     dict->freeze();
     return dict;
 }
 
+// characters are decoded from UTF-8, plus the begin and end of word symbols
 template<class It>
-std::shared_ptr<dytools::Dict> build_conll_char_dict(const DictSettings& settings, It begin, It end)
+std::shared_ptr<dytools::CharDict> build_conll_char_dict(It begin, It end)
 {
-    auto dict = std::make_shared<dytools::Dict>(settings);
+    auto dict = std::make_shared<dytools::CharDict>();
     for(;begin != end; ++begin)
     {
-        const ConllSentence& sentence = *begin;
-        for (const ConllToken& token : sentence)
-        {
-            const std::string &word = token.word;
-            for (unsigned i = 0u; i < word.size(); ++i)
-            {
-                const char c = word[i];
-                dict->convert(std::to_string(c));
-            }
-        }
+        const auto& sentence = *begin;
+        for (const auto& token : sentence)
+            dict->add_word(token.word);
     }
-    dict->convert("<s>");
-    dict->convert("</s>");
-    dict->freeze();
+    dict->add(CharDict::begin_symbol);
+    dict->add(CharDict::end_symbol);
     return dict;
 }
 
@@ -110,9 +296,9 @@ std::shared_ptr<dytools::Dict> build_conll_tag_dict(It begin, It end)
     auto dict = std::make_shared<dytools::Dict>();
     for(;begin != end; ++begin)
     {
-        const ConllSentence& sentence = *begin;
-        for (const ConllToken& token : sentence)
-            dict->convert(token.postag);
+        const auto& sentence = *begin;
+        for (const auto& token : sentence)
+            dict->add(token.postag);
     }
     dict->freeze();
     return dict;
@@ -124,9 +310,9 @@ std::shared_ptr<dytools::Dict> build_conll_label_dict(It begin, It end)
     auto dict = std::make_shared<dytools::Dict>();
     for(;begin != end; ++begin)
     {
-        const ConllSentence& sentence = *begin;
-        for (const ConllToken& token : sentence)
-            dict->convert(token.deprel);
+        const auto& sentence = *begin;
+        for (const auto& token : sentence)
+            dict->add(token.deprel);
     }
     dict->freeze();
     return dict;
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dytools/dict.h"
+#include "dytools/char_dict.h"
+#include "dytools/thread_pool.h"
+
+namespace dytools
+{
+
+struct ConllDictSettings
+{
+    // normalization of the token dictionary
+    bool lowercase = false;
+    bool has_num = false;
+
+    // words and characters seen less often are mapped to *UNK*
+    unsigned min_word_count = 1u;
+    unsigned min_char_count = 1u;
+};
+
+struct ConllDicts
+{
+    std::shared_ptr<Dict> token_dict;
+    std::shared_ptr<CharDict> char_dict;
+    std::shared_ptr<Dict> tag_dict;
+    std::shared_ptr<Dict> label_dict;
+};
+
+// number of occurrences of the entries of each dictionary
+struct ConllCounts
+{
+    std::unordered_map<std::string, unsigned> words; // normalized
+    std::unordered_map<std::uint32_t, unsigned> chars;
+    std::unordered_map<std::string, unsigned> tags;
+    std::unordered_map<std::string, unsigned> labels;
+
+    void merge(const ConllCounts& other);
+};
+
+/**
+ * Builds the dictionaries from the counts.
+ * Ids are deterministic: entries are sorted by decreasing frequency (ties by increasing value),
+ * so frequent words get small, cache-local embedding rows.
+ * The token, tag and label dictionaries are frozen.
+ * @param settings
+ * @param counts
+ * @return
+ */
+ConllDicts build_conll_dicts(const ConllDictSettings& settings, const ConllCounts& counts);
+
+/**
+ * Builds the token, character, tag and label dictionaries in a single parallel pass:
+ * each thread counts a shard of the corpus in its own maps, which are merged at the end.
+ * @param corpus std::vector<ConllSentence> or InternedConllCorpus (anything with size() and operator[])
+ * @param settings
+ * @param pool
+ * @return
+ */
+template <class Corpus>
+ConllDicts build_conll_dicts(const Corpus& corpus, const ConllDictSettings& settings, ThreadPool& pool)
+{
+    const unsigned n_sentences = corpus.size();
+    // small shards for load balancing
+    const unsigned n_shards = std::max(1u, std::min(n_sentences, 4u * pool.size()));
+
+    std::vector<ConllCounts> thread_counts(pool.size());
+    pool.run(n_shards, [&] (const unsigned shard, const unsigned thread) {
+        ConllCounts& counts = thread_counts[thread];
+        const Dict normalizer(settings.lowercase, settings.has_num, false);
+        std::vector<std::uint32_t> code_points;
+
+        const unsigned begin = (unsigned) ((std::uint64_t) n_sentences * shard / n_shards);
+        const unsigned end = (unsigned) ((std::uint64_t) n_sentences * (shard + 1u) / n_shards);
+        for (unsigned i = begin ; i < end ; ++i)
+        {
+            const auto& sentence = corpus[i];
+            for (const auto& token : sentence)
+            {
+                ++ counts.words[normalizer.normalize(token.word)];
+
+                CharDict::decode(token.word, code_points);
+                for (const std::uint32_t c : code_points)
+                    ++ counts.chars[c];
+
+                ++ counts.tags[token.postag];
+                ++ counts.labels[token.deprel];
+            }
+        }
+    });
+
+    for (unsigned i = 1u ; i < thread_counts.size() ; ++i)
+        thread_counts[0].merge(thread_counts[i]);
+    return build_conll_dicts(settings, thread_counts[0]);
+}
+
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/utility/string_ref.hpp>
+
+#include "dytools/data/conll.h"
+
+namespace dytools
+{
+
+/**
+ * Each distinct string is stored once and identified by a 32-bit id.
+ * Not thread-safe.
+ */
+struct StringPool
+{
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    std::uint32_t intern(const boost::string_ref& str);
+
+    inline const std::string& operator[](const std::uint32_t id) const
+    {
+        return strings[id];
+    }
+
+    inline unsigned size() const
+    {
+        return strings.size();
+    }
+
+private:
+    struct Hash
+    {
+        std::size_t operator()(const boost::string_ref& str) const;
+    };
+
+    // a deque never moves its elements, so the keys of the map (views into the strings) stay valid
+    std::deque<std::string> strings;
+    std::unordered_map<boost::string_ref, std::uint32_t, Hash> ids;
+};
+
+// iterator over container[0], container[1], ... where operator[] returns a proxy by value
+template <class Container, class Value>
+struct ProxyIterator
+{
+    typedef std::input_iterator_tag iterator_category;
+    typedef Value value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Value* pointer;
+    typedef Value reference;
+
+    const Container* container;
+    unsigned index;
+
+    inline Value operator*() const
+    {
+        return (*container)[index];
+    }
+
+    inline ProxyIterator& operator++()
+    {
+        ++ index;
+        return *this;
+    }
+
+    inline bool operator==(const ProxyIterator& other) const
+    {
+        return index == other.index;
+    }
+
+    inline bool operator!=(const ProxyIterator& other) const
+    {
+        return index != other.index;
+    }
+};
+
+/**
+ * Token of an InternedConllCorpus, same fields as ConllToken (as references into the string pool),
+ * so the code written for ConllToken (getters, dictionary builders) can be reused.
+ */
+struct InternedConllToken
+{
+    const std::string& word;
+    const std::string& lemma;
+    const std::string& cpostag;
+    const std::string& postag;
+    const std::string& feats;
+    const unsigned head;
+    const std::string& deprel;
+    const std::string& phead;
+    const std::string& pdeprel;
+
+    ConllToken to_token() const;
+};
+
+struct InternedConllCorpus;
+
+// view of a sentence of an InternedConllCorpus
+struct InternedConllSentence
+{
+    typedef ProxyIterator<InternedConllSentence, InternedConllToken> const_iterator;
+
+    const InternedConllCorpus* corpus;
+    unsigned first_token;
+    unsigned n_words;
+
+    inline unsigned size() const
+    {
+        return n_words;
+    }
+
+    InternedConllToken operator[](const unsigned i) const;
+    InternedConllToken at(const unsigned i) const;
+
+    inline const_iterator begin() const
+    {
+        return const_iterator{this, 0u};
+    }
+
+    inline const_iterator end() const
+    {
+        return const_iterator{this, n_words};
+    }
+
+    ConllSentence to_sentence() const;
+};
+
+/**
+ * Structure-of-arrays corpus: one array of 32-bit string ids per CoNLL column,
+ * all columns share the same string pool.
+ * This is a lot smaller than a std::vector<ConllSentence>, where each field of each token is a std::string.
+ */
+struct InternedConllCorpus
+{
+    typedef ProxyIterator<InternedConllCorpus, InternedConllSentence> const_iterator;
+
+    StringPool strings;
+
+    // n_sentences + 1 entries, index of the first token of each sentence
+    std::vector<std::uint32_t> sentence_offsets = std::vector<std::uint32_t>(1u, 0u);
+
+    std::vector<std::uint32_t> words;
+    std::vector<std::uint32_t> lemmas;
+    std::vector<std::uint32_t> cpostags;
+    std::vector<std::uint32_t> postags;
+    std::vector<std::uint32_t> feats;
+    std::vector<unsigned> heads;
+    std::vector<std::uint32_t> deprels;
+    std::vector<std::uint32_t> pheads;
+    std::vector<std::uint32_t> pdeprels;
+
+    inline unsigned size() const
+    {
+        return sentence_offsets.size() - 1u;
+    }
+
+    InternedConllSentence operator[](const unsigned i) const;
+    InternedConllSentence at(const unsigned i) const;
+
+    inline const_iterator begin() const
+    {
+        return const_iterator{this, 0u};
+    }
+
+    inline const_iterator end() const
+    {
+        return const_iterator{this, size()};
+    }
+
+    void push_back(const ConllSentence& sentence);
+    void push_back(const ConllSentenceRef& sentence);
+};
+
+/**
+ * Reads a CoNLL file directly into the interned representation, without building intermediate strings.
+ * Same conventions as read() in conll.h.
+ * @param path
+ * @param output
+ * @return number of sentences read
+ */
+unsigned read(const std::string& path, InternedConllCorpus& output);
+
+}
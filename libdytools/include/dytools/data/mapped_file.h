@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace dytools
+{
+
+/**
+ * Read-only memory mapping of a whole file.
+ * Views into the file content (e.g. the fields of ConllTokenRef) are valid as long as the mapping is alive.
+ * Files that cannot be mapped (pipes, /dev/stdin...) are read into memory instead, with the same interface.
+ */
+struct MappedFile
+{
+    const char* data = nullptr;
+    std::size_t size = 0u;
+
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline const char* begin() const
+    {
+        return data;
+    }
+
+    inline const char* end() const
+    {
+        return data + size;
+    }
+
+private:
+    // content of files that are not mapped
+    std::vector<char> buffer;
+
+    void read_all(const int fd, const std::string& path);
+};
+
+}
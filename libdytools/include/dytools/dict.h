@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <boost/utility/string_ref.hpp>
 
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/unordered_map.hpp>
@@ -28,18 +30,41 @@ struct Dict
     std::vector<std::string> id_to_word;
     std::unordered_map<std::string, unsigned> word_to_id;
 
+    // read-only representation built by freeze(), it is not serialized
+    struct FrozenSlot
+    {
+        std::uint32_t hash;
+        std::uint32_t id;
+    };
+    bool frozen = false;
+    std::string frozen_words; // all words, concatenated
+    std::vector<std::uint32_t> frozen_offsets; // word of id i: [frozen_offsets[i], frozen_offsets[i + 1])
+    std::vector<FrozenSlot> frozen_table; // open addressing with linear probing
+
     Dict(bool _lowercase=false, bool _has_num=false, bool _has_unk=false);
 
     std::string normalize(const std::string& word) const;
-    unsigned to_id(const std::string& _word) const;
+    // on a frozen dict, lookups do not allocate: normalization is applied on the fly while hashing and comparing
+    unsigned to_id(const boost::string_ref& _word) const;
     unsigned to_id(const char& _char) const;
     std::string to_string(const unsigned id) const;
 
+    /**
+     * Builds the read-only representation used by to_id,
+     * the dict cannot be modified anymore (add throws).
+     */
+    void freeze();
+
     void add(const std::string& _word);
     void add(const char& _char);
+    // the word is inserted as is, e.g. a key that was already built with normalize()
+    void add_normalized(const std::string& word);
 
     unsigned size() const;
 
+    // fingerprint of the normalization settings and of the vocabulary (with its ids)
+    std::uint64_t hash() const;
+
     void swap(Dict& other);
 
     template<class Archive>
@@ -52,6 +77,15 @@ struct Dict
         ar & num_id;
         ar & id_to_word;
         ar & word_to_id;
+
+        // the frozen representation must be rebuilt for the new vocabulary
+        if (Archive::is_loading::value)
+        {
+            frozen = false;
+            frozen_words.clear();
+            frozen_offsets.clear();
+            frozen_table.clear();
+        }
     }
 };
 
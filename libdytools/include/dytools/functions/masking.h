@@ -1,12 +1,36 @@
 #pragma once
 
+#include <vector>
+
 #include "dynet/expr.h"
 
 namespace dytools
 {
 
+enum struct MaskKind
+{
+    MainDiagonal, // value on the main diagonal, 0 elsewhere
+    MainDiagonalButFirst, // same, except for the first element of the diagonal
+    AllButFirst // value everywhere except for the first element of the tensor (i.e. of the first batch element)
+};
+
+/**
+ * Values of a constant mask, computed once per (kind, dims, batch, value) and shared by all computation graphs.
+ * The returned vector is never modified nor freed, so it can be given to dynet::input by pointer:
+ * the graph then reads it during the forward pass instead of copying it when it is built.
+ * Thread-safe.
+ * @param kind
+ * @param dim
+ * @param value
+ * @return
+ */
+const std::vector<float>* cached_mask(const MaskKind kind, const dynet::Dim& dim, const float value=1.f);
+
+// input node for the cached mask above
+dynet::Expression mask(dynet::ComputationGraph& cg, const MaskKind kind, const dynet::Dim& dim, const float value=1.f);
+
 dynet::Expression main_diagonal_mask(dynet::ComputationGraph& cg, const dynet::Dim dim, const float value=1.f);
 
 dynet::Expression all_but_first_vector_mask(dynet::ComputationGraph& cg, const unsigned size);
 
-}
\ No newline at end of file
+}
@@ -5,6 +5,17 @@
 namespace dytools
 {
 
+/**
+ * Arc marginals of the distribution over arborescences rooted at vertex 0 (matrix-tree theorem).
+ * The whole batch is computed by a single node: Laplacians are built and factorized (LU) in parallel
+ * across batch elements, and the backward pass is analytic.
+ * Scores are shifted by the max of each column before exponentiation, so large scores do not overflow.
+ * @param cg
+ * @param arc_weights (n_max_vertices x n_max_vertices) matrices of arc scores (head + mod * n_max_vertices), possibly batched
+ * @param n_vertices number of vertices (including the root) of each batch element,
+ *                   nullptr means that all graphs have n_max_vertices vertices
+ * @return marginals, with the same layout as the input, 0 for padding, self-loops and arcs entering the root
+ */
 dynet::Expression rooted_arborescence_marginals(
         dynet::ComputationGraph& cg,
         const dynet::Expression& arc_weights,
@@ -17,4 +28,26 @@ dynet::Expression rooted_arborescence_marginals(
         const std::vector<unsigned>* n_vertices = nullptr
 );
 
-}
\ No newline at end of file
+/**
+ * Log-partition function of the same distribution, computed in the log domain:
+ * scores are shifted by the max of each column and the log-determinant of the Laplacian
+ * is read from its LU factors, so it does not overflow for long sentences.
+ * Its gradient with respect to the arc scores is given by the marginals.
+ * @param cg
+ * @param arc_weights same as above
+ * @param n_vertices same as above
+ * @return one scalar per batch element
+ */
+dynet::Expression rooted_arborescence_log_partition(
+        dynet::ComputationGraph& cg,
+        const dynet::Expression& arc_weights,
+        const std::vector<unsigned>& n_vertices
+);
+
+dynet::Expression rooted_arborescence_log_partition(
+        dynet::ComputationGraph& cg,
+        const dynet::Expression& arc_weights,
+        const std::vector<unsigned>* n_vertices = nullptr
+);
+
+}
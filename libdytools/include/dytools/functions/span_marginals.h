@@ -0,0 +1,47 @@
+#pragma once
+
+#include "dynet/expr.h"
+
+namespace dytools
+{
+
+/**
+ * Log-partition function of binary constituency trees, computed by a single node with the
+ * inside algorithm (outside algorithm for the backward pass).
+ * Span weights use the same layout as binary_span_parser: weight of span (left, right) at left + right * n_max_words.
+ * @param cg
+ * @param span_weights (n_max_words x n_max_words) matrices, possibly batched
+ * @param n_words number of words of each batch element (nullptr: all sentences have n_max_words words),
+ *                the padding part of the weight matrices is ignored
+ * @return one scalar per batch element
+ */
+dynet::Expression span_log_partition(
+        dynet::ComputationGraph& cg,
+        const dynet::Expression& span_weights,
+        const std::vector<unsigned>& n_words
+);
+
+dynet::Expression span_log_partition(
+        dynet::ComputationGraph& cg,
+        const dynet::Expression& span_weights,
+        const std::vector<unsigned>* n_words = nullptr
+);
+
+/**
+ * Marginal probabilities of spans, same layout as the input (0 for padding and for left >= right).
+ * This node has no backward pass: use span_log_partition for training,
+ * its gradient with respect to the weights is the marginals.
+ */
+dynet::Expression span_marginals(
+        dynet::ComputationGraph& cg,
+        const dynet::Expression& span_weights,
+        const std::vector<unsigned>& n_words
+);
+
+dynet::Expression span_marginals(
+        dynet::ComputationGraph& cg,
+        const dynet::Expression& span_weights,
+        const std::vector<unsigned>* n_words = nullptr
+);
+
+}
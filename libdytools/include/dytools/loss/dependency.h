@@ -8,4 +8,37 @@ namespace dytools
 
 dynet::Expression head_neg_log_likelihood(const dynet::Expression& inpur, const std::vector<unsigned> &heads);
 
+/**
+ * Same loss for a minibatch of padded sentences, computed with a few batched operations.
+ * @param input (n_max x n_max) arc weights with one batch element per sentence (head + mod * n_max),
+ *              where n_max is the number of vertices (words + root) of the longest sentence
+ * @param heads heads of each sentence, the size of each vector is the number of vertices of the sentence
+ *              and the first head (root word) is ignored
+ * @return sum of the losses of all sentences
+ */
+dynet::Expression head_neg_log_likelihood(const dynet::Expression& input, const std::vector<std::vector<unsigned>> &heads);
+
+/**
+ * Negative log-likelihood of the gold tree under the distribution over arborescences rooted at the first word
+ * (tree CRF), i.e. log-partition minus the score of the gold tree.
+ * Same arguments as head_neg_log_likelihood: the first head is ignored.
+ */
+dynet::Expression head_tree_crf_loss(const dynet::Expression& input, const std::vector<unsigned> &heads);
+
+/**
+ * Structured hinge loss: score of the best tree under cost-augmented arc weights
+ * (Hamming cost: each wrong head costs cost) minus the score of the gold tree.
+ * The cost-augmented tree is decoded by the loss node itself on the forward values (non-projective decoder),
+ * so building the rest of the graph never waits for it.
+ * Same arguments as head_neg_log_likelihood: the first head is ignored.
+ */
+dynet::Expression head_max_margin_loss(const dynet::Expression& input, const std::vector<unsigned> &heads, const float cost = 1.f);
+
+/**
+ * Same loss for a minibatch of padded sentences (same arguments as the batched head_neg_log_likelihood),
+ * sentences are decoded in parallel on the default thread pool.
+ * @return sum of the losses of all sentences
+ */
+dynet::Expression head_max_margin_loss(const dynet::Expression& input, const std::vector<std::vector<unsigned>> &heads, const float cost = 1.f);
+
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include "dynet/model.h"
+
+#include "dytools/data/mapped_file.h"
+
+namespace dytools
+{
+
+/**
+ * Header of the model bundle format, a single file that contains everything needed to rebuild a network.
+ * The file is stored in host byte order:
+ *  - metadata: boost binary archive of the objects given to ModelBundleWriter::save (settings, dictionaries),
+ *    in the order they were saved
+ *  - parameters: n_parameters x ModelBundleParameter, in the order of ParameterCollection::parameters_list()
+ *    followed by ParameterCollection::lookup_parameters_list()
+ *  - names: concatenated parameter names
+ *  - the raw float values of each parameter, aligned on 64 bytes
+ */
+struct ModelBundleHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t n_parameters;
+
+    // byte offsets and sizes of the sections
+    std::uint64_t metadata;
+    std::uint64_t metadata_size;
+    std::uint64_t parameters;
+    std::uint64_t names;
+    std::uint64_t names_size;
+};
+
+struct ModelBundleParameter
+{
+    // byte offset in the names section
+    std::uint64_t name;
+    // byte offset of the values in the file
+    std::uint64_t values;
+    std::uint64_t n_values;
+    std::uint32_t name_size;
+    std::uint32_t lookup;
+    std::uint32_t n_dims;
+    std::uint32_t dims[7];
+};
+
+/**
+ * Usage:
+ *   ModelBundleWriter out;
+ *   out.save(settings);
+ *   out.save(dict);
+ *   out.save_parameters(network.local_pc);
+ *   out.write(path);
+ */
+struct ModelBundleWriter
+{
+    ModelBundleWriter();
+
+    template <class T>
+    void save(const T& object);
+
+    // copies the current values, so the collection can be modified before the call to write()
+    void save_parameters(const dynet::ParameterCollection& pc);
+
+    void write(const std::string& path);
+
+private:
+    struct Parameter
+    {
+        std::string name;
+        bool lookup;
+        dynet::Dim dim;
+        std::vector<float> values;
+    };
+
+    std::ostringstream metadata;
+    boost::archive::binary_oarchive oarchive;
+    std::vector<Parameter> parameters;
+};
+
+/**
+ * The file is memory-mapped: metadata is deserialized from the mapping
+ * and parameter values are copied directly into the tensors, nothing is parsed as text.
+ * Objects must be loaded in the same order they were saved.
+ */
+struct ModelBundleLoader
+{
+    explicit ModelBundleLoader(const std::string& path);
+
+    ModelBundleLoader(const ModelBundleLoader&) = delete;
+    ModelBundleLoader& operator=(const ModelBundleLoader&) = delete;
+
+    template <class T>
+    void load(T& object);
+
+    // throws if the parameters (names, dimensions) of pc do not match the ones of the bundle
+    void populate(dynet::ParameterCollection& pc) const;
+
+private:
+    // read-only stream buffer over the metadata section of the mapping
+    struct MemoryBuffer : std::streambuf
+    {
+        MemoryBuffer(const char* begin, const char* end);
+    };
+
+    const MappedFile file;
+    const ModelBundleHeader* header;
+    MemoryBuffer buffer;
+    boost::archive::binary_iarchive iarchive;
+};
+
+// true if the file starts with the magic of the model bundle format
+bool is_model_bundle(const std::string& path);
+
+template <class T>
+void ModelBundleWriter::save(const T& object)
+{
+    oarchive << object;
+}
+
+template <class T>
+void ModelBundleLoader::load(T& object)
+{
+    iarchive >> object;
+}
+
+}
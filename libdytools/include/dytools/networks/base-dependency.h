@@ -3,6 +3,7 @@
 #include <utility>
 
 #include "dytools/data/conll.h"
+#include "dytools/algorithms/dependency-parser.h"
 #include "dytools/builders/bilstm.h"
 #include "dytools/builders/biaffine.h"
 #include "dytools/builders/biaffine_tagger.h"
@@ -66,6 +67,10 @@ struct BaseDependencyNetwork : Network<ConllSentence>
 
 struct DependencyParserEvaluator
 {
+    // number of sentences per computation graph, decoded together on the thread pool
+    unsigned batch_size = 32u;
+    DependencyDecoder decoder = DependencyDecoder::NonProjective;
+
     float operator()(BaseDependencyNetwork* network, const std::vector<dytools::ConllSentence>& data) const;
 };
 
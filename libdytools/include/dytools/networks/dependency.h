@@ -31,7 +31,7 @@ struct DependencyNetwork : public BaseDependencyNetwork
             dynet::ParameterCollection& pc,
             const DependencySettings& settings,
             std::shared_ptr<dytools::Dict> token_dict,
-            std::shared_ptr<dytools::Dict> char_dict,
+            std::shared_ptr<dytools::CharDict> char_dict,
             std::shared_ptr<dytools::Dict> tagger_dict,
             std::shared_ptr<dytools::Dict> label_dict
             );
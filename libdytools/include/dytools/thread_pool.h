@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dytools
+{
+
+/**
+ * Fixed set of worker threads that execute a range of tasks.
+ * Tasks are handed out one at a time in increasing index order to whichever thread is idle,
+ * so callers should put the most expensive tasks first to balance the load.
+ * The calling thread takes part in the computation (it has thread id 0).
+ * Calls to run() must not be nested.
+ */
+struct ThreadPool
+{
+    /**
+     * @param n_threads total number of threads including the caller, 0 means one per hardware thread
+     */
+    explicit ThreadPool(unsigned n_threads = 0u);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const;
+
+    /**
+     * Calls f(task, thread_id) for each task in [0, n_tasks) and waits for completion.
+     * If a task throws, the remaining tasks are skipped and the first exception is rethrown.
+     */
+    void run(const unsigned n_tasks, const std::function<void(unsigned, unsigned)>& f);
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    bool stop = false;
+    unsigned generation = 0u;
+    unsigned n_running = 0u;
+
+    const std::function<void(unsigned, unsigned)>* job = nullptr;
+    unsigned n_tasks = 0u;
+    std::atomic<unsigned> next_task;
+    std::exception_ptr error;
+
+    void worker(const unsigned thread_id);
+    void work(const unsigned thread_id);
+};
+
+// process-wide pool, created on first use
+ThreadPool& get_default_thread_pool();
+
+}
@@ -1,19 +1,24 @@
 #pragma once
 
 #include <boost/regex.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <dynet/expr.h>
 #include <dynet/devices.h>
+#include <dynet/tensor.h>
+
+#include "dytools/algorithms/score-matrix.h"
 
 namespace dytools
 {
 
+// reference definitions of is_num and is_punct, which are implemented without regex
 extern const boost::regex regex_num;
 extern const boost::regex regex_punct;
 
 std::string exec(const char* cmd);
 
-bool is_num(const std::string& s);
-bool is_punct(const std::string& s);
+bool is_num(const boost::string_ref& s);
+bool is_punct(const boost::string_ref& s);
 std::string to_lower(const std::string& s);
 
 
@@ -55,4 +60,22 @@ bool is_gpu_default()
     return dynet::default_device->type == dynet::DeviceType::GPU;
 }
 
+/**
+ * View over the values of a matrix tensor.
+ * The values are read in place when the tensor lives on the CPU,
+ * otherwise they are copied into buffer that must then outlive the view.
+ * @param tensor
+ * @param buffer
+ * @return
+ */
+inline
+ScoreMatrix as_score_matrix(const dynet::Tensor& tensor, std::vector<float>& buffer)
+{
+    if (tensor.device->type == dynet::DeviceType::CPU)
+        return ScoreMatrix(tensor.v, tensor.d.rows(), tensor.d.cols());
+
+    buffer = dynet::as_vector(tensor);
+    return ScoreMatrix(buffer.data(), tensor.d.rows(), tensor.d.cols());
+}
+
 }
\ No newline at end of file
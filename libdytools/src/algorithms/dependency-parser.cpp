@@ -1,17 +1,93 @@
 #include "dytools/algorithms/dependency-parser.h"
+#include "dytools/algorithms/reduction.h"
+
+#include <algorithm>
 #include <cassert>
 #include <limits>
+#include <queue>
+#include <stdexcept>
 
 namespace dytools
 {
 
-std::vector<unsigned> non_projective_dependency_parser(const unsigned size, const std::vector<float>& arc_weights)
+namespace
+{
+
+// state of a slot in RunTarjan
+const char TARJAN_UNVISITED = 0;
+const char TARJAN_ON_PATH = 1;
+const char TARJAN_DONE = 2;
+
+}
+
+void ArborescenceWorkspace::resize(const unsigned length)
+{
+    weights.resize(length * length);
+    edge_head.resize(length * length);
+    edge_mod.resize(length * length);
+
+    best_weight.resize(length);
+    slot_id.resize(length);
+    state.resize(length);
+    active.resize(length);
+    in_cycle.resize(length);
+
+    resize_forest(length);
+}
+
+void ArborescenceWorkspace::resize_forest(const unsigned length)
+{
+    path.reserve(length);
+    cycle.reserve(length);
+
+    // each contraction removes at least one vertex, so there is at most 2n-1 nodes in the forest
+    parent.resize(2 * length);
+    in_head.resize(2 * length);
+    in_mod.resize(2 * length);
+    children_begin.resize(2 * length);
+    children_end.resize(2 * length);
+    children.reserve(2 * length);
+    stack.reserve(2 * length);
+    entry.resize(2 * length);
+    kept.resize(2 * length);
+
+    heads.reserve(length);
+}
+
+void SparseArborescenceWorkspace::resize(const unsigned length, const unsigned top_k)
 {
+    // the dense buffers of tarjan are only allocated if the dense decoder is used as a fallback
+    tarjan.resize_forest(length);
+
+    candidates_begin.resize(2 * length);
+    candidates_end.resize(2 * length);
+    // the arena grows when candidate lists are merged
+    candidate_head.reserve(length * (top_k + 1));
+    candidate_mod.reserve(length * (top_k + 1));
+    candidate_weight.reserve(length * (top_k + 1));
+
+    representative.resize(2 * length);
+    state.resize(2 * length);
+    best_weight.resize(2 * length);
+
+    order.resize(length);
+    root_in_top_k.resize(length);
+}
+
+std::vector<unsigned> non_projective_dependency_parser(const unsigned size, const std::vector<float>& arc_weights, const NonProjectiveAlgorithm algorithm)
+{
+    std::vector<unsigned> ret;
+    if (algorithm == NonProjectiveAlgorithm::Tarjan)
+    {
+        ArborescenceWorkspace workspace;
+        non_projective_dependency_parser(size, arc_weights.data(), workspace, ret);
+        return ret;
+    }
+
     float value = 0.f;
     std::vector<int> heads;
     RunCLE(size + 1, arc_weights, &heads, &value);
 
-    std::vector<unsigned> ret;
     for (unsigned i = 1 ; i < heads.size() ; ++i)
     {
         if (heads.at(i) == 0)
@@ -22,6 +98,134 @@ std::vector<unsigned> non_projective_dependency_parser(const unsigned size, cons
     return ret;
 }
 
+void non_projective_dependency_parser(const unsigned size, const float* arc_weights, ArborescenceWorkspace& workspace, std::vector<unsigned>& output)
+{
+    float value = 0.f;
+    RunTarjan(size + 1, arc_weights, &workspace, &workspace.heads, &value);
+
+    output.resize(size);
+    for (unsigned i = 1 ; i < size + 1 ; ++i)
+    {
+        const int head = workspace.heads[i];
+        output[i - 1] = (head == 0 ? i - 1 : head - 1);
+    }
+}
+
+void non_projective_dependency_parser(const ScoreMatrix& arc_weights, ArborescenceWorkspace& workspace, std::vector<unsigned>& output)
+{
+    if (arc_weights.rows != arc_weights.cols || arc_weights.rows == 0u)
+        throw std::runtime_error("Arc weights must be a non-empty square matrix");
+    if (!arc_weights.contiguous())
+        throw std::runtime_error("Arc weights must be stored contiguously");
+    non_projective_dependency_parser(arc_weights.rows - 1u, arc_weights.data, workspace, output);
+}
+
+bool pruned_non_projective_dependency_parser(const unsigned size, const float* arc_weights, const unsigned top_k, SparseArborescenceWorkspace& workspace, std::vector<unsigned>& output)
+{
+    float value = 0.f;
+    std::vector<int>& heads = workspace.tarjan.heads;
+    const bool fallback = RunPrunedTarjan(size + 1, arc_weights, top_k, &workspace, &heads, &value);
+    if (fallback)
+        RunTarjan(size + 1, arc_weights, &workspace.tarjan, &heads, &value);
+
+    output.resize(size);
+    for (unsigned i = 1 ; i < size + 1 ; ++i)
+    {
+        const int head = heads[i];
+        output[i - 1] = (head == 0 ? i - 1 : head - 1);
+    }
+    return !fallback;
+}
+
+namespace
+{
+
+template<class Decoder>
+void batch_dependency_parser(const std::vector<unsigned>& sizes, const std::vector<const float*>& arc_weights, std::vector<std::vector<unsigned>>& output, ThreadPool& pool, Decoder decoder)
+{
+    if (sizes.size() != arc_weights.size())
+        throw std::length_error("Size list and weight list are of different size");
+
+    // decoding is (at least) quadratic in the sentence length: schedule long sentences first
+    std::vector<unsigned> order(sizes.size());
+    for (unsigned i = 0u ; i < order.size() ; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&sizes] (const unsigned a, const unsigned b) {
+        return sizes[a] > sizes[b];
+    });
+
+    output.resize(sizes.size());
+    pool.run((unsigned) order.size(), [&] (const unsigned task, const unsigned) {
+        const unsigned i = order[task];
+        decoder(sizes[i], arc_weights[i], output[i]);
+    });
+}
+
+}
+
+void non_projective_dependency_parser(const std::vector<unsigned>& sizes, const std::vector<const float*>& arc_weights, std::vector<std::vector<unsigned>>& output, ThreadPool& pool)
+{
+    batch_dependency_parser(sizes, arc_weights, output, pool, [] (const unsigned size, const float* weights, std::vector<unsigned>& heads) {
+        // pool threads are persistent, so each of them keeps its workspace between batches
+        static thread_local ArborescenceWorkspace workspace;
+        non_projective_dependency_parser(size, weights, workspace, heads);
+    });
+}
+
+std::vector<unsigned> projective_dependency_parser(const unsigned size, const std::vector<float>& arc_weights)
+{
+    std::vector<unsigned> ret;
+    projective_dependency_parser(size, arc_weights.data(), ret);
+    return ret;
+}
+
+void projective_dependency_parser(const unsigned size, const float* arc_weights, std::vector<unsigned>& output)
+{
+    float value = 0.f;
+    std::vector<int> heads;
+    RunEisner(size + 1, arc_weights, &heads, &value);
+
+    output.resize(size);
+    for (unsigned i = 1 ; i < size + 1 ; ++i)
+    {
+        const int head = heads[i];
+        output[i - 1] = (head == 0 ? i - 1 : head - 1);
+    }
+}
+
+void projective_dependency_parser(const std::vector<unsigned>& sizes, const std::vector<const float*>& arc_weights, std::vector<std::vector<unsigned>>& output, ThreadPool& pool)
+{
+    batch_dependency_parser(sizes, arc_weights, output, pool, [] (const unsigned size, const float* weights, std::vector<unsigned>& heads) {
+        projective_dependency_parser(size, weights, heads);
+    });
+}
+
+std::vector<ScoredDependencyTree> k_best_non_projective_dependency_parser(const unsigned size, const std::vector<float>& arc_weights, const unsigned k)
+{
+    std::vector<std::vector<int>> heads;
+    std::vector<float> values;
+    RunKBestCamerini(size + 1, arc_weights.data(), k, &heads, &values);
+
+    std::vector<ScoredDependencyTree> ret(heads.size());
+    for (unsigned t = 0u ; t < heads.size() ; ++t)
+    {
+        ret[t].score = values[t];
+        for (unsigned i = 1 ; i < size + 1 ; ++i)
+        {
+            const int head = heads[t][i];
+            ret[t].heads.push_back(head == 0 ? i - 1 : head - 1);
+        }
+    }
+    return ret;
+}
+
+void dependency_parser(const DependencyDecoder decoder, const std::vector<unsigned>& sizes, const std::vector<const float*>& arc_weights, std::vector<std::vector<unsigned>>& output, ThreadPool& pool)
+{
+    if (decoder == DependencyDecoder::Projective)
+        projective_dependency_parser(sizes, arc_weights, output, pool);
+    else
+        non_projective_dependency_parser(sizes, arc_weights, output, pool);
+}
 
 // Code stolen from AD3
 
@@ -239,4 +443,724 @@ void RunChuLiuEdmondsIteration(std::vector<bool> *disabled,
 }
 
 
-}
\ No newline at end of file
+
+namespace
+{
+
+struct NoSelectionCallback
+{
+    void operator()(const ArborescenceWorkspace&, const int, const int, const int) const
+    {}
+};
+
+// Contraction phase of RunTarjan, ws.weights must be filled by the caller.
+// If track_parallel is true, ws.second_weights contains the weight of the second best arc
+// between two (contracted) vertices and is maintained during contractions.
+// The callback is called each time a slot selects its incoming arc.
+// If preferred_heads is given, ties are broken in favor of the arcs of this tree.
+// Returns the number of nodes in the contraction forest.
+template<bool track_parallel, class Callback>
+int tarjan_contract(const int n, ArborescenceWorkspace& ws, Callback& callback, const int* preferred_heads = nullptr)
+{
+    for (int m = 0; m < n; ++m) {
+        for (int h = 0; h < n; ++h) {
+            ws.edge_head[h + m * n] = h;
+            ws.edge_mod[h + m * n] = m;
+        }
+        ws.slot_id[m] = m;
+        ws.state[m] = TARJAN_UNVISITED;
+        ws.active[m] = 1;
+        ws.in_cycle[m] = 0;
+    }
+    for (int id = 0; id < 2 * n; ++id)
+        ws.parent[id] = -1;
+    ws.children.clear();
+    ws.state[0] = TARJAN_DONE;
+    int next_id = n;
+
+    for (int start = 1; start < n; ++start) {
+        if (ws.state[start] != TARJAN_UNVISITED) continue;
+
+        ws.path.clear();
+        ws.path.push_back(start);
+        ws.state[start] = TARJAN_ON_PATH;
+        int a = start;
+        while (true) {
+            // Pick the best incoming arc of a, the column is contiguous in memory.
+            const float* in_weights = &ws.weights[a * n];
+            int best = -1;
+            float best_weight = -std::numeric_limits<float>::infinity();
+            for (int u = 0; u < n; ++u) {
+                if (u == a || !ws.active[u]) continue;
+                if (best < 0 || in_weights[u] > best_weight) {
+                    best = u;
+                    best_weight = in_weights[u];
+                }
+                else if (preferred_heads != nullptr && in_weights[u] == best_weight
+                         && preferred_heads[ws.edge_mod[u + a * n]] == ws.edge_head[u + a * n])
+                    best = u;
+            }
+            const int a_id = ws.slot_id[a];
+            ws.in_head[a_id] = ws.edge_head[best + a * n];
+            ws.in_mod[a_id] = ws.edge_mod[best + a * n];
+            ws.best_weight[a] = best_weight;
+            callback(ws, n, a, best);
+
+            if (ws.state[best] == TARJAN_DONE) {
+                for (const int v : ws.path)
+                    ws.state[v] = TARJAN_DONE;
+                break;
+            }
+            if (ws.state[best] == TARJAN_UNVISITED) {
+                a = best;
+                ws.state[a] = TARJAN_ON_PATH;
+                ws.path.push_back(a);
+                continue;
+            }
+
+            // Found a cycle: pop it from the path and create a new node in the forest.
+            const int cycle_id = next_id++;
+            ws.cycle.clear();
+            ws.children_begin[cycle_id] = (int) ws.children.size();
+            while (true) {
+                const int v = ws.path.back();
+                ws.path.pop_back();
+                ws.cycle.push_back(v);
+                ws.in_cycle[v] = 1;
+                ws.children.push_back(ws.slot_id[v]);
+                ws.parent[ws.slot_id[v]] = cycle_id;
+                if (v == best) break;
+            }
+            ws.children_end[cycle_id] = (int) ws.children.size();
+
+            // Contract the cycle into the slot of one of its vertices.
+            // Incoming arcs are reweighted by the score of the arc they would replace.
+            const int c = best;
+            for (int x = 0; x < n; ++x) {
+                if (!ws.active[x] || ws.in_cycle[x]) continue;
+
+                int best_in = -1;
+                float best_in_weight = -std::numeric_limits<float>::infinity();
+                float second_in_weight = -std::numeric_limits<float>::infinity();
+                for (const int v : ws.cycle) {
+                    const float w = ws.weights[x + v * n] - ws.best_weight[v];
+                    if (best_in < 0 || w > best_in_weight) {
+                        second_in_weight = best_in_weight;
+                        best_in = v;
+                        best_in_weight = w;
+                    }
+                    else {
+                        if (w > second_in_weight)
+                            second_in_weight = w;
+                        if (preferred_heads != nullptr && w == best_in_weight
+                            && preferred_heads[ws.edge_mod[x + v * n]] == ws.edge_head[x + v * n])
+                            best_in = v;
+                    }
+                    if (track_parallel) {
+                        const float w2 = ws.second_weights[x + v * n] - ws.best_weight[v];
+                        if (w2 > second_in_weight)
+                            second_in_weight = w2;
+                    }
+                }
+                const int in_head = ws.edge_head[x + best_in * n];
+                const int in_mod = ws.edge_mod[x + best_in * n];
+                ws.weights[x + c * n] = best_in_weight;
+                ws.edge_head[x + c * n] = in_head;
+                ws.edge_mod[x + c * n] = in_mod;
+                if (track_parallel)
+                    ws.second_weights[x + c * n] = second_in_weight;
+
+                // there is no arc to the root
+                if (x == 0) continue;
+
+                int best_out = -1;
+                float best_out_weight = -std::numeric_limits<float>::infinity();
+                float second_out_weight = -std::numeric_limits<float>::infinity();
+                for (const int v : ws.cycle) {
+                    const float w = ws.weights[v + x * n];
+                    if (best_out < 0 || w > best_out_weight) {
+                        second_out_weight = best_out_weight;
+                        best_out = v;
+                        best_out_weight = w;
+                    }
+                    else {
+                        if (w > second_out_weight)
+                            second_out_weight = w;
+                        if (preferred_heads != nullptr && w == best_out_weight
+                            && preferred_heads[ws.edge_mod[v + x * n]] == ws.edge_head[v + x * n])
+                            best_out = v;
+                    }
+                    if (track_parallel && ws.second_weights[v + x * n] > second_out_weight)
+                        second_out_weight = ws.second_weights[v + x * n];
+                }
+                const int out_head = ws.edge_head[best_out + x * n];
+                const int out_mod = ws.edge_mod[best_out + x * n];
+                ws.weights[c + x * n] = best_out_weight;
+                ws.edge_head[c + x * n] = out_head;
+                ws.edge_mod[c + x * n] = out_mod;
+                if (track_parallel)
+                    ws.second_weights[c + x * n] = second_out_weight;
+            }
+            for (const int v : ws.cycle) {
+                ws.in_cycle[v] = 0;
+                if (v != c) ws.active[v] = 0;
+            }
+
+            ws.slot_id[c] = cycle_id;
+            ws.path.push_back(c);
+            a = c;
+        }
+    }
+
+    return next_id;
+}
+
+// Expansion phase of RunTarjan: each root of the forest keeps its incoming arc, which breaks the cycles
+// on the path from the modifier of this arc to the root of the forest.
+// Siblings along this path become roots in turn.
+// For each node of the forest, also sets whether its incoming arc is part of the tree (ws.kept)
+// and the vertex through which the tree enters it (ws.entry).
+void tarjan_expand(const int n, const int n_nodes, ArborescenceWorkspace& ws, std::vector<int> *heads)
+{
+    heads->resize(n);
+    (*heads)[0] = -1;
+    ws.entry[0] = 0;
+    ws.kept[0] = 0;
+    ws.stack.clear();
+    for (int id = 1; id < n_nodes; ++id) {
+        ws.kept[id] = 0;
+        if (ws.parent[id] < 0)
+            ws.stack.push_back(id);
+    }
+    while (!ws.stack.empty()) {
+        const int u = ws.stack.back();
+        ws.stack.pop_back();
+
+        const int m = ws.in_mod[u];
+        (*heads)[m] = ws.in_head[u];
+        ws.kept[u] = 1;
+        ws.entry[u] = m;
+        for (int x = m; x != u; x = ws.parent[x]) {
+            ws.entry[x] = m;
+            const int p = ws.parent[x];
+            for (int k = ws.children_begin[p]; k < ws.children_end[p]; ++k)
+                if (ws.children[k] != x)
+                    ws.stack.push_back(ws.children[k]);
+        }
+    }
+}
+
+}
+
+// Tarjan's algorithm for dense graphs (see also Camerini et al., 1979 for the expansion phase).
+// Vertices are processed along a path of best incoming arcs: when the path reaches the root or
+// a vertex already attached to the root, all vertices on the path are done; when it closes on
+// itself, the cycle is contracted in place in the weight matrix. Each arc selection and each
+// contraction is linear in the number of slots, hence O(n^2) overall.
+void RunTarjan(const unsigned length, const float* scores, ArborescenceWorkspace* workspace, std::vector<int> *heads, float *value)
+{
+    const int n = (int) length;
+    ArborescenceWorkspace& ws = *workspace;
+    ws.resize(length);
+
+    std::copy(scores, scores + n * n, ws.weights.begin());
+    NoSelectionCallback callback;
+    const int n_nodes = tarjan_contract<false>(n, ws, callback);
+    tarjan_expand(n, n_nodes, ws, heads);
+
+    *value = 0;
+    for (int m = 1; m < n; ++m) {
+        const int h = (*heads)[m];
+        assert(h >= 0 && h < n);
+        *value += scores[h + m * n];
+    }
+}
+
+namespace
+{
+
+int find_representative(std::vector<int>& representative, int id)
+{
+    int root = id;
+    while (representative[root] != root)
+        root = representative[root];
+    while (representative[id] != root) {
+        const int next = representative[id];
+        representative[id] = root;
+        id = next;
+    }
+    return root;
+}
+
+}
+
+// Same algorithm as RunTarjan, except that the incoming arcs of each node of the forest
+// are in a candidate list instead of a column of the weight matrix:
+// a contracted cycle gets the concatenation of the (reweighted) lists of its vertices
+// and arcs whose head has been merged in the same node are skipped lazily.
+bool RunPrunedTarjan(const unsigned length, const float* scores, const unsigned top_k, SparseArborescenceWorkspace* workspace, std::vector<int> *heads, float *value)
+{
+    const int n = (int) length;
+    SparseArborescenceWorkspace& sws = *workspace;
+    ArborescenceWorkspace& ws = sws.tarjan;
+    sws.resize(length, top_k);
+
+    // Candidate selection, the column of m is contiguous in memory.
+    // The top_k heads are kept sorted in a small buffer: most heads are rejected by a single comparison.
+    sws.candidate_head.clear();
+    sws.candidate_mod.clear();
+    sws.candidate_weight.clear();
+    sws.candidates_begin[0] = sws.candidates_end[0] = 0;
+    const int max_candidates = std::min((int) top_k, n - 2);
+    for (int m = 1; m < n; ++m) {
+        const float* in_weights = &scores[m * n];
+        int n_candidates = 0;
+        for (int h = 0; h < n; ++h) {
+            if (h == m) continue;
+            const float w = in_weights[h];
+            if (n_candidates == max_candidates) {
+                if (n_candidates == 0 || !(w > in_weights[sws.order[n_candidates - 1]])) continue;
+                --n_candidates;
+            }
+            int k = n_candidates++;
+            for (; k > 0 && w > in_weights[sws.order[k - 1]]; --k)
+                sws.order[k] = sws.order[k - 1];
+            sws.order[k] = h;
+        }
+
+        sws.candidates_begin[m] = (int) sws.candidate_head.size();
+        sws.root_in_top_k[m] = 0;
+        for (int k = 0; k < n_candidates; ++k) {
+            const int h = sws.order[k];
+            sws.root_in_top_k[m] |= (h == 0);
+            sws.candidate_head.push_back(h);
+            sws.candidate_mod.push_back(m);
+            sws.candidate_weight.push_back(in_weights[h]);
+        }
+        if (!sws.root_in_top_k[m]) {
+            sws.candidate_head.push_back(0);
+            sws.candidate_mod.push_back(m);
+            sws.candidate_weight.push_back(in_weights[0]);
+        }
+        sws.candidates_end[m] = (int) sws.candidate_head.size();
+    }
+
+    for (int id = 0; id < 2 * n; ++id) {
+        ws.parent[id] = -1;
+        sws.representative[id] = id;
+        sws.state[id] = TARJAN_UNVISITED;
+    }
+    ws.children.clear();
+    sws.state[0] = TARJAN_DONE;
+    int next_id = n;
+
+    for (int start = 1; start < n; ++start) {
+        if (sws.state[start] != TARJAN_UNVISITED) continue;
+
+        ws.path.clear();
+        ws.path.push_back(start);
+        sws.state[start] = TARJAN_ON_PATH;
+        int a = start;
+        while (true) {
+            // Pick the best incoming arc of a whose head is not inside a.
+            int best = -1;
+            float best_weight = -std::numeric_limits<float>::infinity();
+            int best_source = -1;
+            for (int k = sws.candidates_begin[a]; k < sws.candidates_end[a]; ++k) {
+                const int source = find_representative(sws.representative, sws.candidate_head[k]);
+                if (source == a) continue;
+                if (best < 0 || sws.candidate_weight[k] > best_weight) {
+                    best = k;
+                    best_weight = sws.candidate_weight[k];
+                    best_source = source;
+                }
+            }
+            // there is always an arc from the root
+            assert(best >= 0);
+            ws.in_head[a] = sws.candidate_head[best];
+            ws.in_mod[a] = sws.candidate_mod[best];
+            sws.best_weight[a] = best_weight;
+
+            if (sws.state[best_source] == TARJAN_DONE) {
+                for (const int v : ws.path)
+                    sws.state[v] = TARJAN_DONE;
+                break;
+            }
+            if (sws.state[best_source] == TARJAN_UNVISITED) {
+                a = best_source;
+                sws.state[a] = TARJAN_ON_PATH;
+                ws.path.push_back(a);
+                continue;
+            }
+
+            // Found a cycle: pop it from the path and create a new node in the forest.
+            const int c = next_id++;
+            ws.cycle.clear();
+            ws.children_begin[c] = (int) ws.children.size();
+            while (true) {
+                const int v = ws.path.back();
+                ws.path.pop_back();
+                ws.cycle.push_back(v);
+                ws.children.push_back(v);
+                ws.parent[v] = c;
+                sws.representative[v] = c;
+                if (v == best_source) break;
+            }
+            ws.children_end[c] = (int) ws.children.size();
+
+            // Merge the candidate lists of the cycle, reweighted by the score of the arc they would replace.
+            sws.candidates_begin[c] = (int) sws.candidate_head.size();
+            for (const int v : ws.cycle) {
+                for (int k = sws.candidates_begin[v]; k < sws.candidates_end[v]; ++k) {
+                    if (find_representative(sws.representative, sws.candidate_head[k]) == c) continue;
+                    sws.candidate_head.push_back(sws.candidate_head[k]);
+                    sws.candidate_mod.push_back(sws.candidate_mod[k]);
+                    sws.candidate_weight.push_back(sws.candidate_weight[k] - sws.best_weight[v]);
+                }
+            }
+            sws.candidates_end[c] = (int) sws.candidate_head.size();
+
+            sws.state[c] = TARJAN_ON_PATH;
+            ws.path.push_back(c);
+            a = c;
+        }
+    }
+
+    tarjan_expand(n, next_id, ws, heads);
+
+    bool fallback = false;
+    *value = 0;
+    for (int m = 1; m < n; ++m) {
+        const int h = (*heads)[m];
+        assert(h >= 0 && h < n);
+        *value += scores[h + m * n];
+        fallback |= (h == 0 && !sws.root_in_top_k[m]);
+    }
+    return fallback;
+}
+
+
+namespace
+{
+
+// Subset of the trees of the graph defined by the arcs it must contain and the arcs it must not contain.
+struct CameriniSubproblem
+{
+    std::vector<int> fixed; // head that each modifier must have, or -1
+    std::vector<int> excluded; // arcs, as head + mod * length
+
+    // best tree of the subproblem
+    std::vector<int> heads;
+    float value;
+
+    // the second best tree of the subproblem is the best one without this arc
+    int next_arc;
+    float next_value;
+};
+
+struct CameriniWorkspace
+{
+    ArborescenceWorkspace tarjan;
+    std::vector<int> children_begin;
+    std::vector<int> children;
+    std::vector<int> preorder;
+    std::vector<int> subtree_size;
+    std::vector<int> stack;
+    std::vector<int> preferred_heads;
+
+    CameriniWorkspace(const unsigned length) :
+        children_begin(length + 1),
+        children(length),
+        preorder(length),
+        subtree_size(length)
+    {
+        tarjan.resize(length);
+        tarjan.second_weights.resize(length * length);
+        stack.reserve(length + 1);
+    }
+};
+
+// Called during the second contraction of camerini_next: compares the arc selected by each
+// node of the forest that is kept in the best tree with its best alternative.
+// Replacing the incoming arc of a (contracted) vertex by an arc from a vertex which is not
+// one of its descendants gives a valid tree whose weight is given by the reduced weights.
+struct CameriniCallback
+{
+    const CameriniWorkspace& cws;
+    int best_node = -1;
+    float best_gap = std::numeric_limits<float>::infinity();
+
+    CameriniCallback(const CameriniWorkspace& _cws) :
+        cws(_cws)
+    {}
+
+    void operator()(const ArborescenceWorkspace& ws, const int n, const int a, const int best)
+    {
+        const int a_id = ws.slot_id[a];
+        if (!ws.kept[a_id])
+            return;
+
+        const int first = cws.preorder[ws.entry[a_id]];
+        const int last = first + cws.subtree_size[ws.entry[a_id]];
+        const float* in_weights = &ws.weights[a * n];
+        const float* in_second_weights = &ws.second_weights[a * n];
+        for (int u = 0; u < n; ++u) {
+            if (u == a || !ws.active[u]) continue;
+
+            float w;
+            if (u == best)
+                w = in_second_weights[u]; // parallel arc from the same head
+            else {
+                const int source = cws.preorder[ws.entry[ws.slot_id[u]]];
+                if (source >= first && source < last) continue;
+                w = in_weights[u];
+            }
+            const float gap = ws.best_weight[a] - w;
+            if (gap < best_gap) {
+                best_node = a_id;
+                best_gap = gap;
+            }
+        }
+    }
+};
+
+void camerini_weights(const int n, const float* scores, const CameriniSubproblem& subproblem, std::vector<float>& weights)
+{
+    std::copy(scores, scores + n * n, weights.begin());
+    for (const int arc : subproblem.excluded)
+        weights[arc] = -std::numeric_limits<float>::infinity();
+    for (int m = 1; m < n; ++m) {
+        if (subproblem.fixed[m] < 0) continue;
+        for (int h = 0; h < n; ++h)
+            if (h != subproblem.fixed[m])
+                weights[h + m * n] = -std::numeric_limits<float>::infinity();
+    }
+}
+
+// Computes the best tree of the subproblem and the arc that must be removed from it
+// to obtain the second best tree. Returns false if there is no second best tree.
+// If the subproblem already has a best tree, the same one is kept in case of ties
+// (it may already have been returned to the user).
+bool camerini_next(const int n, const float* scores, CameriniSubproblem& subproblem, CameriniWorkspace& cws)
+{
+    ArborescenceWorkspace& ws = cws.tarjan;
+    const int* preferred_heads = nullptr;
+    if (subproblem.heads.size() > 0u)
+    {
+        cws.preferred_heads = subproblem.heads;
+        preferred_heads = cws.preferred_heads.data();
+    }
+
+    // first pass: best tree
+    camerini_weights(n, scores, subproblem, ws.weights);
+    NoSelectionCallback no_callback;
+    const int n_nodes = tarjan_contract<false>(n, ws, no_callback, preferred_heads);
+    tarjan_expand(n, n_nodes, ws, &subproblem.heads);
+    subproblem.value = 0.f;
+    for (int m = 1; m < n; ++m)
+        subproblem.value += scores[subproblem.heads[m] + m * n];
+
+    // preorder numbering of the tree: u is a descendant of v iff its number is in v's interval
+    const std::vector<int>& heads = subproblem.heads;
+    std::fill(cws.children_begin.begin(), cws.children_begin.end(), 0);
+    for (int m = 1; m < n; ++m)
+        ++cws.children_begin[heads[m] + 1];
+    for (int v = 0; v < n; ++v)
+        cws.children_begin[v + 1] += cws.children_begin[v];
+    cws.stack.assign(cws.children_begin.begin(), cws.children_begin.end() - 1);
+    for (int m = 1; m < n; ++m)
+        cws.children[cws.stack[heads[m]]++] = m;
+
+    cws.stack.clear();
+    cws.stack.push_back(0);
+    int next_number = 0;
+    while (!cws.stack.empty()) {
+        const int v = cws.stack.back();
+        cws.stack.pop_back();
+        cws.preorder[v] = next_number++;
+        for (int k = cws.children_begin[v]; k < cws.children_begin[v + 1]; ++k)
+            cws.stack.push_back(cws.children[k]);
+    }
+    // children have greater preorder numbers than their head, so process vertices by decreasing number
+    cws.stack.resize(n);
+    for (int v = 0; v < n; ++v) {
+        cws.subtree_size[v] = 1;
+        cws.stack[cws.preorder[v]] = v;
+    }
+    for (int k = n - 1; k > 0; --k) {
+        const int v = cws.stack[k];
+        cws.subtree_size[heads[v]] += cws.subtree_size[v];
+    }
+
+    // second pass: same contractions, but we look for the cheapest swap
+    camerini_weights(n, scores, subproblem, ws.weights);
+    std::fill(ws.second_weights.begin(), ws.second_weights.end(), -std::numeric_limits<float>::infinity());
+    CameriniCallback callback(cws);
+    tarjan_contract<true>(n, ws, callback, preferred_heads);
+
+    if (callback.best_node < 0 || callback.best_gap == std::numeric_limits<float>::infinity())
+        return false;
+    subproblem.next_arc = ws.in_head[callback.best_node] + ws.in_mod[callback.best_node] * n;
+    subproblem.next_value = subproblem.value - callback.best_gap;
+    return true;
+}
+
+}
+
+void RunKBestCamerini(const unsigned length, const float* scores, const unsigned k, std::vector<std::vector<int>> *heads, std::vector<float> *values)
+{
+    const int n = (int) length;
+    heads->clear();
+    values->clear();
+    if (k == 0u)
+        return;
+
+    CameriniWorkspace workspace(length);
+    std::vector<CameriniSubproblem> subproblems(1);
+    subproblems[0].fixed.assign(length, -1);
+    const bool has_next = camerini_next(n, scores, subproblems[0], workspace);
+    // no spanning tree with finite weight
+    if (!(subproblems[0].value > -std::numeric_limits<float>::infinity()))
+        return;
+    heads->push_back(subproblems[0].heads);
+    values->push_back(subproblems[0].value);
+
+    auto compare = [&subproblems] (const unsigned a, const unsigned b) {
+        return subproblems[a].next_value < subproblems[b].next_value;
+    };
+    std::priority_queue<unsigned, std::vector<unsigned>, decltype(compare)> queue(compare);
+    if (has_next)
+        queue.push(0u);
+
+    while (!queue.empty() && heads->size() < k) {
+        const unsigned current = queue.top();
+        queue.pop();
+        const int arc = subproblems[current].next_arc;
+
+        // subproblem without the arc: its best tree is the second best of the current one
+        CameriniSubproblem without;
+        without.fixed = subproblems[current].fixed;
+        without.excluded = subproblems[current].excluded;
+        without.excluded.push_back(arc);
+        const bool without_has_next = camerini_next(n, scores, without, workspace);
+        heads->push_back(without.heads);
+        values->push_back(without.value);
+
+        // subproblem with the arc: same best tree, but another second best
+        subproblems[current].fixed[arc / n] = arc % n;
+        if (camerini_next(n, scores, subproblems[current], workspace))
+            queue.push(current);
+
+        subproblems.push_back(std::move(without));
+        if (without_has_next)
+            queue.push((unsigned) subproblems.size() - 1u);
+    }
+}
+
+void RunEisner(const unsigned length, const float* scores, std::vector<int> *heads, float *value)
+{
+    const unsigned n = length;
+    const float minus_inf = -std::numeric_limits<float>::infinity();
+
+    // complete items: right (head on the left) and left (head on the right)
+    std::vector<float> right_complete_row(n * n, 0.f); // [left * n + right]
+    std::vector<float> right_complete_col(n * n, 0.f); // [right * n + left]
+    std::vector<float> left_complete_row(n * n, 0.f);
+    std::vector<float> left_complete_col(n * n, 0.f);
+    // incomplete items: right stored row-major, left stored column-major
+    std::vector<float> right_incomplete_row(n * n, minus_inf);
+    std::vector<float> left_incomplete_col(n * n, minus_inf);
+
+    std::vector<unsigned> right_complete_bp(n * n);
+    std::vector<unsigned> left_complete_bp(n * n);
+    std::vector<unsigned> incomplete_bp(n * n);
+
+    for (unsigned span = 1u; span < n; ++span) {
+        for (unsigned s = 0u; s + span < n; ++s) {
+            const unsigned t = s + span;
+            unsigned r;
+
+            // incomplete items: max_{s <= r < t} C[s -> r] + C[r+1 <- t]
+            const float base = max_plus(
+                    &right_complete_row[s * n + s],
+                    &left_complete_col[t * n + s + 1],
+                    span,
+                    r
+            );
+            incomplete_bp[s * n + t] = s + r;
+            right_incomplete_row[s * n + t] = base + scores[s + t * n];
+            // the root can't be a modifier
+            left_incomplete_col[t * n + s] = (s == 0u ? minus_inf : base + scores[t + s * n]);
+
+            // right complete item: max_{s < r <= t} I[s -> r] + C[r -> t]
+            const float right = max_plus(
+                    &right_incomplete_row[s * n + s + 1],
+                    &right_complete_col[t * n + s + 1],
+                    span,
+                    r
+            );
+            right_complete_row[s * n + t] = right;
+            right_complete_col[t * n + s] = right;
+            right_complete_bp[s * n + t] = s + 1 + r;
+
+            // left complete item: max_{s <= r < t} C[s <- r] + I[r <- t]
+            const float left = max_plus(
+                    &left_complete_row[s * n + s],
+                    &left_incomplete_col[t * n + s],
+                    span,
+                    r
+            );
+            left_complete_row[s * n + t] = left;
+            left_complete_col[t * n + s] = left;
+            left_complete_bp[s * n + t] = s + r;
+        }
+    }
+
+    // backtracking
+    enum ItemType { RightComplete, LeftComplete, RightIncomplete, LeftIncomplete };
+    struct Item { unsigned s; unsigned t; ItemType type; };
+
+    heads->assign(length, 0);
+    (*heads)[0] = -1;
+    std::vector<Item> stack;
+    stack.push_back({0u, n - 1u, RightComplete});
+    while (!stack.empty()) {
+        const Item item = stack.back();
+        stack.pop_back();
+        if (item.s == item.t) continue;
+
+        const unsigned s = item.s;
+        const unsigned t = item.t;
+        switch (item.type) {
+            case RightComplete: {
+                const unsigned r = right_complete_bp[s * n + t];
+                stack.push_back({s, r, RightIncomplete});
+                stack.push_back({r, t, RightComplete});
+                break;
+            }
+            case LeftComplete: {
+                const unsigned r = left_complete_bp[s * n + t];
+                stack.push_back({s, r, LeftComplete});
+                stack.push_back({r, t, LeftIncomplete});
+                break;
+            }
+            case RightIncomplete:
+            case LeftIncomplete: {
+                if (item.type == RightIncomplete)
+                    (*heads)[t] = (int) s;
+                else
+                    (*heads)[s] = (int) t;
+                const unsigned r = incomplete_bp[s * n + t];
+                stack.push_back({s, r, RightComplete});
+                stack.push_back({r + 1, t, LeftComplete});
+                break;
+            }
+        }
+    }
+
+    *value = 0;
+    for (unsigned m = 1; m < n; ++m)
+        *value += scores[(*heads)[m] + m * n];
+}
+
+}
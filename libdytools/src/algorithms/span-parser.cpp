@@ -1,65 +1,219 @@
 #include "dytools/algorithms/span-parser.h"
+#include "dytools/algorithms/reduction.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <stdexcept>
 
 namespace dytools
 {
 
-Tree binary_span_parser(const unsigned size, const std::vector<float> &weights)
+void SpanParserWorkspace::resize(const unsigned size)
 {
-    std::vector<float> cst_weights(size * size, 0.f);
-    std::vector<unsigned> back_ptr(size * size);
+    row.resize(size * size);
+    col.resize(size * size);
+    back_ptr.resize(size * size);
+    stack.reserve(2 * size);
+}
+
+Tree binary_span_parser(const unsigned size, const std::vector<float> &weights, const unsigned max_length)
+{
+    if (weights.size() != size * size)
+        throw std::runtime_error("Span weights do not match the sentence size");
+    return binary_span_parser(ScoreMatrix(weights.data(), size, size), max_length);
+}
+
+Tree binary_span_parser(const ScoreMatrix& weights, const unsigned max_length)
+{
+    if (weights.rows != weights.cols)
+        throw std::runtime_error("Span weights must be a square matrix");
+    const unsigned size = weights.rows;
+    Tree tree;
+    if (size == 0u)
+        return tree;
+
+    SpanParserWorkspace workspace;
+    std::vector<Span> spans(2 * size - 1);
+    binary_span_parser(weights, workspace, spans.data(), max_length);
+
+    for (const auto& span : spans)
+        if (span.first < span.second)
+            tree.insert(span);
+
+    return tree;
+}
+
+void binary_span_parser(const ScoreMatrix& weights, SpanParserWorkspace& workspace, Span* output, const unsigned max_length)
+{
+    if (weights.rows != weights.cols)
+        throw std::runtime_error("Span weights must be a square matrix");
+    const unsigned size = weights.rows;
+    if (size == 0u)
+        return;
+
+    // The chart is stored twice: the weight of span (left, right) is both in
+    // row[left * size + right] and in col[right * size + left].
+    // For a given span, the left antecedents (left, k) are then contiguous in row
+    // and the right antecedents (k + 1, right) are contiguous in col,
+    // so the max over split points is a vectorized reduction.
+    workspace.resize(size);
+    float* row = workspace.row.data();
+    float* col = workspace.col.data();
+    unsigned* back_ptr = workspace.back_ptr.data();
+    for (unsigned i = 0 ; i < size ; ++i)
+    {
+        row[i * size + i] = 0.f;
+        col[i * size + i] = 0.f;
+    }
 
     // bottom-up constituency network computation
+    // (length is the number of split points, i.e. the number of words of the span minus one)
     for (unsigned length = 1 ; length < size ; ++length)
     {
-        for (unsigned left = 0 ; left < size - length; ++ left)
+        // when the span length is capped, only the suffix of the sentence is built
+        // and its left child is a short span
+        const bool backbone = (max_length > 0u && length >= max_length);
+        const unsigned n_splits = (backbone ? max_length : length);
+        for (unsigned left = (backbone ? size - 1 - length : 0) ; left < size - length; ++ left)
         {
             const unsigned right = left + length;
-            float max_weight = -std::numeric_limits<float>::infinity();
-            int max_k = 0;
-            for (unsigned k = left ; k < right ; ++k)
-            {
-                const float w = cst_weights.at(left + k * size) + cst_weights.at(k + 1 + right * size);
-                if (w > max_weight)
-                {
-                    max_weight = w;
-                    max_k = k;
-                }
-            }
-            //std::cerr << "\n";
-            const float local_weight = weights.at(left + right * size);
-            cst_weights.at(left + right * size) = local_weight +max_weight;
-            back_ptr.at(left + right * size) = max_k;
+
+            unsigned argmax;
+            const float max_weight = max_plus(&row[left * size + left], &col[right * size + left + 1], n_splits, argmax);
+
+            const float w = weights(left, right) + max_weight;
+            row[left * size + right] = w;
+            col[right * size + left] = w;
+            back_ptr[left + right * size] = left + argmax;
         }
     }
 
-    // top-down linear-time reconstruction
-    std::vector<Span> queue;
-    Tree tree;
-
-    queue.emplace_back(0u, size - 1u);
-    while(queue.size() > 0)
+    // top-down linear-time reconstruction, the right child is pushed first so that spans are output in pre-order
+    auto& stack = workspace.stack;
+    stack.clear();
+    stack.emplace_back(0u, size - 1u);
+    while (stack.size() > 0)
     {
-        // remove from the queue and add to the tree
-        const auto span = queue.back();
-        queue.pop_back();
+        const auto span = stack.back();
+        stack.pop_back();
+
+        *output = span;
+        ++output;
 
         if (span.first < span.second)
-            tree.emplace(span);
+        {
+            const auto best_k = back_ptr[span.first + span.second * size];
+            stack.emplace_back(best_k + 1, span.second);
+            stack.emplace_back(span.first, best_k);
+        }
+    }
+}
+
+void binary_span_parser(const std::vector<unsigned>& sizes, const std::vector<const float*>& weights, std::vector<Span>& output, std::vector<unsigned>& offsets, ThreadPool& pool, const unsigned max_length)
+{
+    if (sizes.size() != weights.size())
+        throw std::length_error("Size list and weight list are of different size");
+
+    offsets.resize(sizes.size() + 1);
+    offsets[0] = 0u;
+    for (unsigned i = 0u ; i < sizes.size() ; ++i)
+        offsets[i + 1] = offsets[i] + (sizes[i] > 0u ? 2 * sizes[i] - 1 : 0u);
+    output.resize(offsets.back());
 
-        if (span.first + 1 < span.second)
+    // decoding is (at least) linear in the sentence length: schedule long sentences first
+    std::vector<unsigned> order(sizes.size());
+    for (unsigned i = 0u ; i < order.size() ; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&sizes] (const unsigned a, const unsigned b) {
+        return sizes[a] > sizes[b];
+    });
+
+    pool.run((unsigned) order.size(), [&] (const unsigned task, const unsigned) {
+        // pool threads are persistent, so each of them keeps its workspace between batches
+        static thread_local SpanParserWorkspace workspace;
+        const unsigned i = order[task];
+        binary_span_parser(ScoreMatrix(weights[i], sizes[i], sizes[i]), workspace, output.data() + offsets[i], max_length);
+    });
+}
+
+float span_inside_outside(const ScoreMatrix& weights, SpanParserWorkspace& workspace, float* marginals)
+{
+    if (weights.rows != weights.cols)
+        throw std::runtime_error("Span weights must be a square matrix");
+    const unsigned size = weights.rows;
+    if (size == 0u)
+        return 0.f;
+
+    // inside weights, stored twice as in the CKY chart
+    workspace.resize(size);
+    float* row = workspace.row.data();
+    float* col = workspace.col.data();
+    for (unsigned i = 0 ; i < size ; ++i)
+    {
+        row[i * size + i] = 0.f;
+        col[i * size + i] = 0.f;
+    }
+    for (unsigned length = 1 ; length < size ; ++length)
+    {
+        for (unsigned left = 0 ; left < size - length; ++ left)
         {
-            const auto best_k = back_ptr.at(span.first + span.second * size);
-            const auto left_antecedent = std::make_pair(span.first, best_k);
-            const auto right_antecedent = std::make_pair(best_k + 1, span.second);
+            const unsigned right = left + length;
+            const float w = weights(left, right) + log_sum_exp_plus(&row[left * size + left], &col[right * size + left + 1], length);
+            row[left * size + right] = w;
+            col[right * size + left] = w;
+        }
+    }
+    const float log_partition = row[size - 1];
+
+    if (marginals == nullptr)
+        return log_partition;
+
+    // The outside weight of a span is gathered from its parents: (left, parent_right) when it is
+    // the left child, (parent_left, right) when it is the right child. Both sums are over contiguous
+    // arrays if the outside weight of parents (plus their own weight) is also stored twice.
+    workspace.outside_row.resize(size * size);
+    workspace.outside_col.resize(size * size);
+    float* outside_row = workspace.outside_row.data();
+    float* outside_col = workspace.outside_col.data();
+    for (unsigned right = 0 ; right < size ; ++right)
+        for (unsigned left = right ; left < size ; ++left)
+            marginals[left + right * weights.stride] = 0.f;
+
+    for (unsigned length = size - 1 ; length > 0u ; --length)
+    {
+        for (unsigned left = 0 ; left < size - length; ++ left)
+        {
+            const unsigned right = left + length;
 
-            queue.push_back(left_antecedent);
-            queue.push_back(right_antecedent);
+            float outside = 0.f;
+            if (length < size - 1)
+            {
+                const float as_left_child = log_sum_exp_plus(
+                        &outside_row[left * size + right + 1],
+                        &row[(right + 1) * size + right + 1],
+                        size - 1 - right
+                );
+                const float as_right_child = log_sum_exp_plus(
+                        &outside_col[right * size],
+                        &col[(left - (left > 0u ? 1u : 0u)) * size],
+                        left
+                );
+                const float max_value = std::max(as_left_child, as_right_child);
+                if (max_value == -std::numeric_limits<float>::infinity())
+                    outside = max_value;
+                else
+                    outside = max_value + std::log(std::exp(as_left_child - max_value) + std::exp(as_right_child - max_value));
+            }
+
+            const float w = weights(left, right);
+            outside_row[left * size + right] = outside + w;
+            outside_col[right * size + left] = outside + w;
+            marginals[left + right * weights.stride] = std::exp(row[left * size + right] + outside - log_partition);
         }
     }
 
-    return tree;
+    return log_partition;
 }
 
-}
\ No newline at end of file
+}
@@ -9,12 +9,17 @@ namespace dytools
 std::vector<unsigned> tagger(const unsigned size, const std::vector<float>& tag_weights)
 {
     const unsigned n_tags = tag_weights.size() / size;
+    return tagger(ScoreMatrix(tag_weights.data(), n_tags, size));
+}
 
+std::vector<unsigned> tagger(const ScoreMatrix& tag_weights)
+{
     std::vector<unsigned> ret;
-    for (unsigned i = 0 ; i < size ; ++i)
+    ret.reserve(tag_weights.cols);
+    for (unsigned i = 0 ; i < tag_weights.cols ; ++i)
     {
-        const auto begin = tag_weights.begin() + i * n_tags;
-        const auto end = tag_weights.begin() + (i + 1) * n_tags;
+        const float* begin = tag_weights.col(i);
+        const float* end = begin + tag_weights.rows;
 
         const auto pred = std::distance(begin, std::max_element(begin, end));
 
@@ -25,4 +30,4 @@ std::vector<unsigned> tagger(const unsigned size, const std::vector<float>& tag_
 }
 
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,267 @@
+#include "dytools/char_dict.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace dytools
+{
+
+namespace
+{
+
+const std::uint32_t missing_id = std::numeric_limits<std::uint32_t>::max();
+const std::uint32_t replacement_character = 0xFFFDu;
+
+inline bool is_continuation(const unsigned char c)
+{
+    return (c & 0xC0u) == 0x80u;
+}
+
+// Decodes the code point starting at it and moves it after it.
+// Overlong encodings, surrogates and values above U+10FFFF are invalid:
+// one byte is consumed and the replacement character is returned.
+inline std::uint32_t decode_utf8(const char*& it, const char* end)
+{
+    const unsigned char c0 = (unsigned char) *it;
+    ++ it;
+    if (c0 < 0x80u)
+        return c0;
+
+    unsigned length;
+    std::uint32_t code_point;
+    std::uint32_t min_value;
+    if ((c0 & 0xE0u) == 0xC0u)
+    {
+        length = 2u;
+        code_point = c0 & 0x1Fu;
+        min_value = 0x80u;
+    }
+    else if ((c0 & 0xF0u) == 0xE0u)
+    {
+        length = 3u;
+        code_point = c0 & 0x0Fu;
+        min_value = 0x800u;
+    }
+    else if ((c0 & 0xF8u) == 0xF0u)
+    {
+        length = 4u;
+        code_point = c0 & 0x07u;
+        min_value = 0x10000u;
+    }
+    else
+        return replacement_character;
+
+    if ((unsigned) (end - it) < length - 1u)
+        return replacement_character;
+    for (unsigned i = 0u ; i < length - 1u ; ++i)
+    {
+        const unsigned char c = (unsigned char) it[i];
+        if (!is_continuation(c))
+            return replacement_character;
+        code_point = (code_point << 6u) | (c & 0x3Fu);
+    }
+    if (code_point < min_value || code_point > 0x10FFFFu || (code_point >= 0xD800u && code_point <= 0xDFFFu))
+        return replacement_character;
+
+    it += length - 1u;
+    return code_point;
+}
+
+inline std::size_t slot_of(const std::uint32_t code_point, const std::size_t mask)
+{
+    // multiplicative hashing, consecutive code points of a script are spread over the table
+    const std::uint32_t h = code_point * 2654435769u;
+    return (std::size_t) (h ^ (h >> 15u)) & mask;
+}
+
+}
+
+const std::uint32_t CharDict::unk_symbol;
+const std::uint32_t CharDict::begin_symbol;
+const std::uint32_t CharDict::end_symbol;
+
+CharDict::CharDict(bool _has_unk) :
+    has_unk(_has_unk)
+{
+    ascii_ids.fill(missing_id);
+    if (has_unk)
+    {
+        unk_id = (unsigned) id_to_code_point.size();
+        add(unk_symbol);
+    }
+}
+
+std::uint32_t CharDict::find(const std::uint32_t code_point) const
+{
+    if (code_point < 128u)
+        return ascii_ids[code_point];
+    if (table.empty())
+        return missing_id;
+
+    const std::size_t mask = table.size() - 1u;
+    for (std::size_t slot = slot_of(code_point, mask) ; table[slot].id != missing_id ; slot = (slot + 1u) & mask)
+        if (table[slot].code_point == code_point)
+            return table[slot].id;
+    return missing_id;
+}
+
+void CharDict::insert(const std::uint32_t code_point, const std::uint32_t id)
+{
+    if (code_point < 128u)
+    {
+        ascii_ids[code_point] = id;
+        return;
+    }
+
+    if (2u * (n_non_ascii + 1u) > table.size())
+    {
+        // grow and reinsert everything
+        std::vector<Slot> old_table;
+        old_table.swap(table);
+        table.assign(std::max<std::size_t>(16u, 2u * old_table.size()), Slot{0u, missing_id});
+        n_non_ascii = 0u;
+        for (const Slot& slot : old_table)
+            if (slot.id != missing_id)
+                insert(slot.code_point, slot.id);
+    }
+
+    ++ n_non_ascii;
+    const std::size_t mask = table.size() - 1u;
+    std::size_t slot = slot_of(code_point, mask);
+    while (table[slot].id != missing_id)
+        slot = (slot + 1u) & mask;
+    table[slot] = Slot{code_point, id};
+}
+
+void CharDict::rebuild_tables()
+{
+    ascii_ids.fill(missing_id);
+    table.clear();
+    n_non_ascii = 0u;
+    for (unsigned id = 0u ; id < id_to_code_point.size() ; ++id)
+        insert(id_to_code_point[id], id);
+}
+
+void CharDict::add(const std::uint32_t code_point)
+{
+    if (find(code_point) != missing_id)
+        return;
+
+    const std::uint32_t id = id_to_code_point.size();
+    id_to_code_point.push_back(code_point);
+    insert(code_point, id);
+}
+
+void CharDict::add_word(const boost::string_ref& word)
+{
+    const char* it = word.begin();
+    while (it != word.end())
+        add(decode_utf8(it, word.end()));
+}
+
+unsigned CharDict::to_id(const std::uint32_t code_point) const
+{
+    const std::uint32_t id = find(code_point);
+    if (id != missing_id)
+        return id;
+    if (has_unk)
+        return unk_id;
+
+    std::ostringstream msg;
+    msg << "Character not in dict: U+" << std::hex << code_point;
+    throw std::runtime_error(msg.str());
+}
+
+void CharDict::to_ids(const boost::string_ref& word, std::vector<unsigned>& output) const
+{
+    output.clear();
+    const char* it = word.begin();
+    while (it != word.end())
+    {
+        const unsigned char c = (unsigned char) *it;
+        if (c < 128u && ascii_ids[c] != missing_id)
+        {
+            output.push_back(ascii_ids[c]);
+            ++ it;
+        }
+        else
+            output.push_back(to_id(decode_utf8(it, word.end())));
+    }
+}
+
+std::vector<unsigned> CharDict::to_ids(const boost::string_ref& word) const
+{
+    std::vector<unsigned> output;
+    to_ids(word, output);
+    return output;
+}
+
+void CharDict::decode(const boost::string_ref& word, std::vector<std::uint32_t>& output)
+{
+    output.clear();
+    const char* it = word.begin();
+    while (it != word.end())
+        output.push_back(decode_utf8(it, word.end()));
+}
+
+std::string CharDict::to_string(const unsigned id) const
+{
+    const std::uint32_t c = id_to_code_point.at(id);
+    if (c == unk_symbol)
+        return "*UNK*";
+    if (c == begin_symbol)
+        return "<s>";
+    if (c == end_symbol)
+        return "</s>";
+
+    std::string ret;
+    if (c < 0x80u)
+        ret += (char) c;
+    else if (c < 0x800u)
+    {
+        ret += (char) (0xC0u | (c >> 6u));
+        ret += (char) (0x80u | (c & 0x3Fu));
+    }
+    else if (c < 0x10000u)
+    {
+        ret += (char) (0xE0u | (c >> 12u));
+        ret += (char) (0x80u | ((c >> 6u) & 0x3Fu));
+        ret += (char) (0x80u | (c & 0x3Fu));
+    }
+    else
+    {
+        ret += (char) (0xF0u | (c >> 18u));
+        ret += (char) (0x80u | ((c >> 12u) & 0x3Fu));
+        ret += (char) (0x80u | ((c >> 6u) & 0x3Fu));
+        ret += (char) (0x80u | (c & 0x3Fu));
+    }
+    return ret;
+}
+
+unsigned CharDict::size() const
+{
+    return (unsigned) id_to_code_point.size();
+}
+
+std::uint64_t CharDict::hash() const
+{
+    // 64 bits FNV-1a
+    std::uint64_t h = 14695981039346656037ull;
+    auto update = [&h] (const std::uint32_t value) {
+        for (unsigned i = 0u ; i < 4u ; ++i)
+        {
+            h ^= (value >> (8u * i)) & 0xFFu;
+            h *= 1099511628211ull;
+        }
+    };
+
+    update(has_unk);
+    update(unk_id);
+    for (const std::uint32_t c : id_to_code_point)
+        update(c);
+    return h;
+}
+
+}
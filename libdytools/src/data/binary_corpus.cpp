@@ -0,0 +1,208 @@
+#include "dytools/data/binary_corpus.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace dytools
+{
+
+namespace
+{
+
+const char binary_corpus_magic[8] = {'D', 'Y', 'C', 'O', 'R', 'P', 'U', 'S'};
+const std::uint32_t binary_corpus_version = 1u;
+const std::uint64_t binary_corpus_alignment = 64u;
+
+inline std::uint64_t align(const std::uint64_t offset)
+{
+    return (offset + binary_corpus_alignment - 1u) / binary_corpus_alignment * binary_corpus_alignment;
+}
+
+template <class T>
+const T* column(const MappedFile& file, const std::uint64_t offset, const std::uint64_t size)
+{
+    if (offset % binary_corpus_alignment != 0u || offset > file.size || size > (file.size - offset) / sizeof(T))
+        throw std::runtime_error("Corrupted binary corpus");
+    return (const T*) (file.data + offset);
+}
+
+template <class T>
+void write_column(std::ofstream& os, const std::vector<T>& values, const std::uint64_t offset)
+{
+    // padding up to the column offset
+    const std::uint64_t position = (std::uint64_t) os.tellp();
+    const std::vector<char> padding(offset - position, 0);
+    os.write(padding.data(), padding.size());
+    os.write((const char*) values.data(), values.size() * sizeof(T));
+}
+
+// starts at 0, ends at total and is non-decreasing
+bool is_offset_list(const std::uint64_t* offsets, const std::uint64_t size, const std::uint64_t total)
+{
+    if (size == 0u || offsets[0] != 0u || offsets[size - 1u] != total)
+        return false;
+    for (std::uint64_t i = 1u ; i < size ; ++i)
+        if (offsets[i] < offsets[i - 1u])
+            return false;
+    return true;
+}
+
+template <class D>
+void check_hash(const std::uint64_t expected, const D& dict, const std::string& name)
+{
+    if (expected != dict.hash())
+        throw std::runtime_error("The binary corpus was built with a different " + name + " dictionary");
+}
+
+}
+
+std::vector<unsigned> BinarySentence::token_ids() const
+{
+    return std::vector<unsigned>(tokens, tokens + n_words);
+}
+
+std::vector<std::vector<unsigned>> BinarySentence::char_ids() const
+{
+    std::vector<std::vector<unsigned>> ret;
+    ret.reserve(n_words);
+    for (unsigned i = 0u ; i < n_words ; ++i)
+        ret.emplace_back(chars + char_offsets[i], chars + char_offsets[i + 1]);
+    return ret;
+}
+
+BinaryCorpus::BinaryCorpus(const std::string& path) :
+    file(path)
+{
+    if (file.size < sizeof(BinaryCorpusHeader) || std::memcmp(file.data, binary_corpus_magic, sizeof(binary_corpus_magic)) != 0)
+        throw std::runtime_error("Not a binary corpus: " + path);
+
+    header = (const BinaryCorpusHeader*) file.data;
+    if (header->version != binary_corpus_version)
+        throw std::runtime_error("Unsupported binary corpus version: " + path);
+
+    // offset columns have one more entry than the count, which must not overflow
+    if (header->n_tokens == std::numeric_limits<std::uint64_t>::max())
+        throw std::runtime_error("Corrupted binary corpus: " + path);
+    const std::uint64_t n_sentence_offsets = (std::uint64_t) header->n_sentences + 1u;
+    const std::uint64_t n_char_offsets = header->n_tokens + 1u;
+
+    sentence_offsets = column<std::uint64_t>(file, header->sentence_offsets, n_sentence_offsets);
+    tokens = column<std::uint32_t>(file, header->tokens, header->n_tokens);
+    char_offsets = column<std::uint64_t>(file, header->char_offsets, n_char_offsets);
+    chars = column<std::uint32_t>(file, header->chars, header->n_chars);
+    tags = column<std::uint32_t>(file, header->tags, header->n_tokens);
+    heads = column<std::uint32_t>(file, header->heads, header->n_tokens);
+    labels = column<std::uint32_t>(file, header->labels, header->n_tokens);
+
+    // sentences and words are views into the columns, so offsets must be non-decreasing and within bounds
+    if (
+            !is_offset_list(sentence_offsets, n_sentence_offsets, header->n_tokens)
+            || !is_offset_list(char_offsets, n_char_offsets, header->n_chars)
+    )
+        throw std::runtime_error("Corrupted binary corpus: " + path);
+}
+
+void BinaryCorpus::check_dicts(const Dict& token_dict, const CharDict& char_dict, const Dict& tag_dict, const Dict& label_dict) const
+{
+    check_hash(header->token_dict_hash, token_dict, "token");
+    check_hash(header->char_dict_hash, char_dict, "character");
+    check_hash(header->tag_dict_hash, tag_dict, "tag");
+    check_hash(header->label_dict_hash, label_dict, "label");
+}
+
+BinarySentence BinaryCorpus::operator[](const unsigned i) const
+{
+    const std::uint64_t begin = sentence_offsets[i];
+    return BinarySentence{
+            (unsigned) (sentence_offsets[i + 1] - begin),
+            tokens + begin,
+            tags + begin,
+            heads + begin,
+            labels + begin,
+            char_offsets + begin,
+            chars
+    };
+}
+
+BinarySentence BinaryCorpus::at(const unsigned i) const
+{
+    if (i >= size())
+        throw std::out_of_range("Sentence index out of range");
+    return (*this)[i];
+}
+
+void write_binary_corpus(
+        const std::string& path,
+        const std::vector<ConllSentence>& data,
+        const Dict& token_dict,
+        const CharDict& char_dict,
+        const Dict& tag_dict,
+        const Dict& label_dict
+)
+{
+    std::vector<std::uint64_t> sentence_offsets;
+    std::vector<std::uint32_t> tokens;
+    std::vector<std::uint64_t> char_offsets;
+    std::vector<std::uint32_t> chars;
+    std::vector<std::uint32_t> tags;
+    std::vector<std::uint32_t> heads;
+    std::vector<std::uint32_t> labels;
+
+    std::vector<unsigned> word_chars;
+    sentence_offsets.push_back(0u);
+    char_offsets.push_back(0u);
+    for (const auto& sentence : data)
+    {
+        for (const auto& token : sentence)
+        {
+            tokens.push_back(token_dict.to_id(token.word));
+            char_dict.to_ids(token.word, word_chars);
+            chars.insert(chars.end(), word_chars.begin(), word_chars.end());
+            char_offsets.push_back(chars.size());
+            tags.push_back(tag_dict.to_id(token.postag));
+            heads.push_back(token.head);
+            labels.push_back(label_dict.to_id(token.deprel));
+        }
+        sentence_offsets.push_back(tokens.size());
+    }
+
+    BinaryCorpusHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, binary_corpus_magic, sizeof(binary_corpus_magic));
+    header.version = binary_corpus_version;
+    header.n_sentences = data.size();
+    header.n_tokens = tokens.size();
+    header.n_chars = chars.size();
+    header.token_dict_hash = token_dict.hash();
+    header.char_dict_hash = char_dict.hash();
+    header.tag_dict_hash = tag_dict.hash();
+    header.label_dict_hash = label_dict.hash();
+
+    header.sentence_offsets = align(sizeof(header));
+    header.tokens = align(header.sentence_offsets + sentence_offsets.size() * sizeof(std::uint64_t));
+    header.char_offsets = align(header.tokens + tokens.size() * sizeof(std::uint32_t));
+    header.chars = align(header.char_offsets + char_offsets.size() * sizeof(std::uint64_t));
+    header.tags = align(header.chars + chars.size() * sizeof(std::uint32_t));
+    header.heads = align(header.tags + tags.size() * sizeof(std::uint32_t));
+    header.labels = align(header.heads + heads.size() * sizeof(std::uint32_t));
+
+    std::ofstream os(path, std::ios::binary);
+    if (!os.is_open())
+        throw std::runtime_error("Could not open file: " + path);
+
+    os.write((const char*) &header, sizeof(header));
+    write_column(os, sentence_offsets, header.sentence_offsets);
+    write_column(os, tokens, header.tokens);
+    write_column(os, char_offsets, header.char_offsets);
+    write_column(os, chars, header.chars);
+    write_column(os, tags, header.tags);
+    write_column(os, heads, header.heads);
+    write_column(os, labels, header.labels);
+
+    if (!os)
+        throw std::runtime_error("Could not write file: " + path);
+}
+
+}
@@ -3,11 +3,172 @@
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
-#include <boost/algorithm/string.hpp>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
 
 namespace dytools
 {
 
+namespace
+{
+
+// first occurence of c in [begin, end), or end
+inline const char* find_char(const char* begin, const char* end, const char c)
+{
+    const void* ptr = std::memchr(begin, c, end - begin);
+    return ptr == nullptr ? end : (const char*) ptr;
+}
+
+inline unsigned parse_unsigned(const boost::string_ref& field)
+{
+    if (field.empty())
+        throw std::runtime_error("Invalid head: empty field");
+
+    unsigned value = 0u;
+    for (const char c : field)
+    {
+        if (c < '0' || c > '9')
+            throw std::runtime_error("Invalid head: " + field.to_string());
+        value = value * 10u + (unsigned) (c - '0');
+    }
+    return value;
+}
+
+// Tokenizes the first sentence of [begin, end) in place, one line at a time:
+// fields are delimited with memchr and stored as views into the buffer.
+// Returns the position after the sentence, or nullptr if there is no sentence left.
+const char* parse_sentence(const char* begin, const char* end, ConllSentenceRef& sentence)
+{
+    bool in_sentence = false;
+    boost::string_ref fields[10];
+
+    while (begin != end)
+    {
+        const char* eol = find_char(begin, end, '\n');
+        const char* next = (eol == end ? end : eol + 1);
+
+        if (eol == begin)
+        {
+            if (in_sentence)
+                return next;
+            begin = next;
+            continue;
+        }
+        if (*begin == '#')
+        {
+            begin = next;
+            continue;
+        }
+
+        in_sentence = true;
+
+        unsigned n_fields = 0u;
+        const char* field = begin;
+        while (n_fields < 10u)
+        {
+            const char* tab = find_char(field, eol, '\t');
+            fields[n_fields] = boost::string_ref(field, tab - field);
+            ++ n_fields;
+            if (tab == eol)
+                break;
+            field = tab + 1;
+        }
+        if (n_fields < 10u)
+            throw std::runtime_error("Invalid CoNLL line: " + std::string(begin, eol));
+
+        // skip ids with . and - inside
+        const boost::string_ref& id = fields[0];
+        if (id.find('.') != boost::string_ref::npos || id.find('-') != boost::string_ref::npos)
+        {
+            begin = next;
+            continue;
+        }
+
+        unsigned head = parse_unsigned(fields[6]);
+        if (head == 0u)
+            head = sentence.size();
+        else
+            head -= 1u; // firt word as index=0, not 1 as in conll
+
+        sentence.push_back(ConllTokenRef{
+                fields[1],
+                fields[2],
+                fields[3],
+                fields[4],
+                fields[5],
+                head,
+                fields[7],
+                fields[8],
+                fields[9]
+        });
+
+        begin = next;
+    }
+
+    return in_sentence ? end : nullptr;
+}
+
+unsigned parse_conll(const char* begin, const char* end, std::vector<ConllSentenceRef>& output)
+{
+    unsigned n = 0u;
+    while (true)
+    {
+        output.emplace_back();
+        begin = parse_sentence(begin, end, output.back());
+        if (begin == nullptr)
+        {
+            output.pop_back();
+            return n;
+        }
+        ++ n;
+    }
+}
+
+// start of the first blank line after position, or end
+const char* next_sentence_boundary(const char* position, const char* end)
+{
+    while (position != end)
+    {
+        const char* eol = find_char(position, end, '\n');
+        if (eol == end || eol + 1 == end)
+            return end;
+        if (eol[1] == '\n')
+            return eol + 1;
+        position = eol + 1;
+    }
+    return end;
+}
+
+// Splits the file into chunks of roughly the same size, each chunk starts at a sentence boundary.
+// Chunks are small enough for load balancing, but not too small so that scanning stays cheap.
+std::vector<const char*> split_in_chunks(const MappedFile& file, const unsigned n_threads)
+{
+    const std::size_t min_chunk_size = 1u << 20u;
+    const std::size_t n_chunks = std::max<std::size_t>(1u, std::min<std::size_t>(4u * n_threads, file.size / min_chunk_size));
+    const std::size_t chunk_size = file.size / n_chunks;
+
+    std::vector<const char*> boundaries;
+    boundaries.push_back(file.begin());
+    for (std::size_t i = 1u ; i < n_chunks ; ++i)
+    {
+        const char* position = std::max(boundaries.back(), file.begin() + i * chunk_size);
+        boundaries.push_back(next_sentence_boundary(position, file.end()));
+    }
+    boundaries.push_back(file.end());
+    return boundaries;
+}
+
+std::unique_ptr<std::istream> open_input(const std::string& path)
+{
+    std::unique_ptr<std::istream> input(new std::ifstream(path, std::ios::binary));
+    if (input->fail())
+        throw std::runtime_error("Could not open file: " + path);
+    return input;
+}
+
+}
+
 ConllToken::ConllToken(
         const std::string& word,
         const std::string& lemma,
@@ -81,95 +242,98 @@ float uas(const ConllSentence& sentence, const std::vector<unsigned>& heads, boo
 }
 
 
+ConllToken ConllTokenRef::to_token() const
+{
+    return ConllToken(
+            word.to_string(),
+            lemma.to_string(),
+            cpostag.to_string(),
+            postag.to_string(),
+            feats.to_string(),
+            head,
+            deprel.to_string(),
+            phead.to_string(),
+            pdeprel.to_string()
+    );
+}
+
+ConllSentence ConllSentenceRef::to_sentence() const
+{
+    ConllSentence sentence;
+    sentence.reserve(size());
+    for (const auto& token : *this)
+        sentence.push_back(token.to_token());
+    return sentence;
+}
+
+const char* read_sentence(const char* begin, const char* end, ConllSentenceRef& sentence)
+{
+    return parse_sentence(begin, end, sentence);
+}
+
+unsigned read(const MappedFile& file, std::vector<ConllSentenceRef>& output)
+{
+    return parse_conll(file.begin(), file.end(), output);
+}
+
 unsigned read(const std::string& path, std::vector<ConllSentence>& output)
 {
-    unsigned n = 0u;
-    unsigned next_token_id = 0u;
-
-    std::string line;
-    std::string id;
-    std::string word;
-    std::string lemma;
-    std::string cpostag;
-    std::string postag;
-    std::string feats;
-    std::string str_head;
-    std::string deprel;
-    std::string phead;
-    std::string pdeprel;
-
-    ConllSentence* sentence = nullptr;
-    std::ifstream is(path);
-    if (!is.is_open())
-        throw std::runtime_error("Could not open file: " + path);
+    const MappedFile file(path);
+    std::vector<ConllSentenceRef> sentences;
+    const unsigned n = read(file, sentences);
 
-    while (std::getline(is, line)) {
-        if (line.length() <= 0)
-        {
-            if (sentence != nullptr)
-            {
-                output.push_back(*sentence);
-                ++ n;
-                delete sentence;
-                sentence = nullptr;
-            }
+    output.reserve(output.size() + sentences.size());
+    for (const auto& sentence : sentences)
+        output.push_back(sentence.to_sentence());
 
-            continue;
-        }
-        if (line[0] == '#')
-            continue;
+    return n;
+}
 
-        if (sentence == nullptr)
-        {
-            sentence = new ConllSentence();
-            next_token_id = 0u;
-        }
+unsigned read(const MappedFile& file, std::vector<ConllSentenceRef>& output, ThreadPool& pool)
+{
+    const auto boundaries = split_in_chunks(file, pool.size());
+    const unsigned n_chunks = boundaries.size() - 1u;
 
-        std::vector<std::string> strs;
-        boost::split(strs, line, boost::is_any_of("\t"));
-        id = strs.at(0);
-        word = strs.at(1);
-        lemma = strs.at(2);
-        cpostag = strs.at(3);
-        postag = strs.at(4);
-        feats = strs.at(5);
-        str_head = strs.at(6);
-        deprel = strs.at(7);
-        phead = strs.at(8);
-        pdeprel = strs.at(9);
+    std::vector<std::vector<ConllSentenceRef>> chunks(n_chunks);
+    pool.run(n_chunks, [&] (const unsigned chunk, const unsigned) {
+        parse_conll(boundaries[chunk], boundaries[chunk + 1], chunks[chunk]);
+    });
 
-        // skip ids with . and - inside
-        if (id.find(".") != std::string::npos || id.find("-") != std::string::npos)
-            continue;
+    unsigned n = 0u;
+    for (const auto& chunk : chunks)
+        n += chunk.size();
 
-        unsigned head = std::stoul(str_head);
-        if (head == 0u)
-            head = next_token_id;
-        else
-            head -= 1u; // firt word as index=0, not 1 as in conll
+    output.reserve(output.size() + n);
+    for (auto& chunk : chunks)
+        output.insert(output.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
 
-        sentence->emplace_back(
-                word,
-                lemma,
-                cpostag,
-                postag,
-                feats,
-                head,
-                deprel,
-                phead,
-                pdeprel
-        );
-        ++ next_token_id;
-    }
+    return n;
+}
 
-    if (sentence != nullptr)
-    {
-        output.push_back(*sentence);
-        ++ n;
-        delete sentence;
-    }
+unsigned read(const std::string& path, std::vector<ConllSentence>& output, ThreadPool& pool)
+{
+    const MappedFile file(path);
+    const auto boundaries = split_in_chunks(file, pool.size());
+    const unsigned n_chunks = boundaries.size() - 1u;
 
-    is.close();
+    // strings are also built in parallel
+    std::vector<std::vector<ConllSentence>> chunks(n_chunks);
+    pool.run(n_chunks, [&] (const unsigned chunk, const unsigned) {
+        std::vector<ConllSentenceRef> sentences;
+        parse_conll(boundaries[chunk], boundaries[chunk + 1], sentences);
+
+        chunks[chunk].reserve(sentences.size());
+        for (const auto& sentence : sentences)
+            chunks[chunk].push_back(sentence.to_sentence());
+    });
+
+    unsigned n = 0u;
+    for (const auto& chunk : chunks)
+        n += chunk.size();
+
+    output.reserve(output.size() + n);
+    for (auto& chunk : chunks)
+        output.insert(output.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
 
     return n;
 }
@@ -213,4 +377,217 @@ void write(std::ostream& os, const std::vector<ConllSentence>& data)
     }
 }
 
-}
\ No newline at end of file
+ConllReader::iterator::iterator(ConllReader* reader) :
+    reader(reader)
+{
+    ++ *this;
+}
+
+ConllReader::iterator& ConllReader::iterator::operator++()
+{
+    if (!reader->next(sentence))
+        reader = nullptr;
+    return *this;
+}
+
+ConllReader::ConllReader(const std::string& path, const unsigned capacity) :
+    owned_input(open_input(path)),
+    input(*owned_input),
+    capacity(std::max(capacity, 1u)),
+    thread(&ConllReader::produce, this)
+{}
+
+ConllReader::ConllReader(std::istream& input, const unsigned capacity) :
+    input(input),
+    capacity(std::max(capacity, 1u)),
+    thread(&ConllReader::produce, this)
+{}
+
+ConllReader::~ConllReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    not_full.notify_all();
+    thread.join();
+}
+
+bool ConllReader::next(ConllSentence& sentence)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [this] { return !queue.empty() || done; });
+
+    if (queue.empty())
+    {
+        if (error)
+        {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+        return false;
+    }
+
+    sentence = std::move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    not_full.notify_one();
+    return true;
+}
+
+void ConllReader::produce()
+{
+    const std::size_t block_size = 1u << 20u;
+
+    try
+    {
+        // data that has been read but not parsed yet, i.e. the beginning of the next sentence
+        std::string buffer;
+        ConllSentenceRef sentence;
+        bool eof = false;
+        while (!eof)
+        {
+            const std::size_t n_pending = buffer.size();
+            buffer.resize(n_pending + block_size);
+            input.read(&buffer[n_pending], block_size);
+            buffer.resize(n_pending + (std::size_t) input.gcount());
+            if (input.bad())
+                throw std::runtime_error("Could not read CoNLL input");
+            eof = input.eof();
+
+            // only complete sentences are parsed: up to the last blank line, or everything at the end of the input
+            std::size_t limit = buffer.size();
+            if (!eof)
+            {
+                const std::size_t blank_line = buffer.rfind("\n\n");
+                limit = (blank_line == std::string::npos ? 0u : blank_line + 2u);
+            }
+
+            const char* position = buffer.data();
+            const char* end = buffer.data() + limit;
+            while (true)
+            {
+                sentence.clear();
+                position = parse_sentence(position, end, sentence);
+                if (position == nullptr)
+                    break;
+
+                ConllSentence owned = sentence.to_sentence();
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    not_full.wait(lock, [this] { return queue.size() < capacity || stop; });
+                    if (stop)
+                        return;
+                    queue.push_back(std::move(owned));
+                }
+                not_empty.notify_one();
+            }
+            buffer.erase(0u, limit);
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    not_empty.notify_all();
+}
+
+ConllWriter::ConllWriter(std::ostream& os, const unsigned capacity) :
+    os(os),
+    capacity(std::max(capacity, 1u)),
+    thread(&ConllWriter::consume, this)
+{}
+
+ConllWriter::~ConllWriter()
+{
+    if (thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+        thread.join();
+    }
+}
+
+void ConllWriter::write(ConllSentence sentence)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return queue.size() < capacity || error; });
+        if (closed)
+            throw std::runtime_error("Writing to a closed ConllWriter");
+        // the background thread has stopped, the error is reported by close()
+        if (error)
+            return;
+        queue.push_back(std::move(sentence));
+    }
+    not_empty.notify_one();
+}
+
+void ConllWriter::close()
+{
+    if (thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void ConllWriter::consume()
+{
+    try
+    {
+        ConllSentence sentence;
+        while (true)
+        {
+            bool flush;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                not_empty.wait(lock, [this] { return !queue.empty() || closed; });
+                if (queue.empty())
+                    break;
+
+                sentence = std::move(queue.front());
+                queue.pop_front();
+                flush = queue.empty();
+            }
+            not_full.notify_one();
+
+            dytools::write(os, sentence);
+            os << "\n";
+            // nothing else to write for now: make the output available
+            if (flush)
+                os.flush();
+            if (!os)
+                throw std::runtime_error("Could not write CoNLL output");
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+    }
+    not_full.notify_all();
+}
+
+}
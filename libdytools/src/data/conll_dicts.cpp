@@ -0,0 +1,75 @@
+#include "dytools/data/conll_dicts.h"
+
+namespace dytools
+{
+
+namespace
+{
+
+// entries with at least min_count occurrences, by decreasing count then increasing value
+template <class Key>
+std::vector<Key> sorted_entries(const std::unordered_map<Key, unsigned>& counts, const unsigned min_count)
+{
+    std::vector<std::pair<Key, unsigned>> entries;
+    for (const auto& entry : counts)
+        if (entry.second >= min_count)
+            entries.push_back(entry);
+
+    std::sort(entries.begin(), entries.end(), [] (const std::pair<Key, unsigned>& a, const std::pair<Key, unsigned>& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    });
+
+    std::vector<Key> ret;
+    ret.reserve(entries.size());
+    for (const auto& entry : entries)
+        ret.push_back(entry.first);
+    return ret;
+}
+
+template <class Key>
+void merge_counts(std::unordered_map<Key, unsigned>& counts, const std::unordered_map<Key, unsigned>& other)
+{
+    for (const auto& entry : other)
+        counts[entry.first] += entry.second;
+}
+
+}
+
+void ConllCounts::merge(const ConllCounts& other)
+{
+    merge_counts(words, other.words);
+    merge_counts(chars, other.chars);
+    merge_counts(tags, other.tags);
+    merge_counts(labels, other.labels);
+}
+
+ConllDicts build_conll_dicts(const ConllDictSettings& settings, const ConllCounts& counts)
+{
+    ConllDicts dicts;
+
+    dicts.token_dict = std::make_shared<Dict>(settings.lowercase, settings.has_num, true);
+    // words were counted normalized, normalizing them again would e.g. turn *NUM* into *num*
+    for (const auto& word : sorted_entries(counts.words, settings.min_word_count))
+        dicts.token_dict->add_normalized(word);
+    dicts.token_dict->freeze();
+
+    dicts.char_dict = std::make_shared<CharDict>();
+    for (const auto c : sorted_entries(counts.chars, settings.min_char_count))
+        dicts.char_dict->add(c);
+    dicts.char_dict->add(CharDict::begin_symbol);
+    dicts.char_dict->add(CharDict::end_symbol);
+
+    dicts.tag_dict = std::make_shared<Dict>();
+    for (const auto& tag : sorted_entries(counts.tags, 1u))
+        dicts.tag_dict->add(tag);
+    dicts.tag_dict->freeze();
+
+    dicts.label_dict = std::make_shared<Dict>();
+    for (const auto& label : sorted_entries(counts.labels, 1u))
+        dicts.label_dict->add(label);
+    dicts.label_dict->freeze();
+
+    return dicts;
+}
+
+}
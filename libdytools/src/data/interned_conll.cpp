@@ -0,0 +1,133 @@
+#include "dytools/data/interned_conll.h"
+
+#include <stdexcept>
+#include <boost/functional/hash.hpp>
+
+#include "dytools/data/mapped_file.h"
+
+namespace dytools
+{
+
+namespace
+{
+
+// the sentence can contain either ConllToken or ConllTokenRef
+template <class Sentence>
+void append(InternedConllCorpus& corpus, const Sentence& sentence)
+{
+    StringPool& strings = corpus.strings;
+    for (const auto& token : sentence)
+    {
+        corpus.words.push_back(strings.intern(token.word));
+        corpus.lemmas.push_back(strings.intern(token.lemma));
+        corpus.cpostags.push_back(strings.intern(token.cpostag));
+        corpus.postags.push_back(strings.intern(token.postag));
+        corpus.feats.push_back(strings.intern(token.feats));
+        corpus.heads.push_back(token.head);
+        corpus.deprels.push_back(strings.intern(token.deprel));
+        corpus.pheads.push_back(strings.intern(token.phead));
+        corpus.pdeprels.push_back(strings.intern(token.pdeprel));
+    }
+    corpus.sentence_offsets.push_back(corpus.words.size());
+}
+
+}
+
+std::size_t StringPool::Hash::operator()(const boost::string_ref& str) const
+{
+    return boost::hash_range(str.begin(), str.end());
+}
+
+std::uint32_t StringPool::intern(const boost::string_ref& str)
+{
+    const auto it = ids.find(str);
+    if (it != ids.end())
+        return it->second;
+
+    const std::uint32_t id = strings.size();
+    strings.emplace_back(str.data(), str.size());
+    ids.emplace(boost::string_ref(strings.back()), id);
+    return id;
+}
+
+ConllToken InternedConllToken::to_token() const
+{
+    return ConllToken(word, lemma, cpostag, postag, feats, head, deprel, phead, pdeprel);
+}
+
+InternedConllToken InternedConllSentence::operator[](const unsigned i) const
+{
+    const InternedConllCorpus& c = *corpus;
+    const StringPool& s = c.strings;
+    const unsigned t = first_token + i;
+    return InternedConllToken{
+            s[c.words[t]],
+            s[c.lemmas[t]],
+            s[c.cpostags[t]],
+            s[c.postags[t]],
+            s[c.feats[t]],
+            c.heads[t],
+            s[c.deprels[t]],
+            s[c.pheads[t]],
+            s[c.pdeprels[t]]
+    };
+}
+
+InternedConllToken InternedConllSentence::at(const unsigned i) const
+{
+    if (i >= n_words)
+        throw std::out_of_range("Token index out of range");
+    return (*this)[i];
+}
+
+ConllSentence InternedConllSentence::to_sentence() const
+{
+    ConllSentence sentence;
+    sentence.reserve(n_words);
+    for (unsigned i = 0u ; i < n_words ; ++i)
+        sentence.push_back((*this)[i].to_token());
+    return sentence;
+}
+
+InternedConllSentence InternedConllCorpus::operator[](const unsigned i) const
+{
+    return InternedConllSentence{this, sentence_offsets[i], sentence_offsets[i + 1] - sentence_offsets[i]};
+}
+
+InternedConllSentence InternedConllCorpus::at(const unsigned i) const
+{
+    if (i >= size())
+        throw std::out_of_range("Sentence index out of range");
+    return (*this)[i];
+}
+
+void InternedConllCorpus::push_back(const ConllSentence& sentence)
+{
+    append(*this, sentence);
+}
+
+void InternedConllCorpus::push_back(const ConllSentenceRef& sentence)
+{
+    append(*this, sentence);
+}
+
+unsigned read(const std::string& path, InternedConllCorpus& output)
+{
+    const MappedFile file(path);
+
+    unsigned n = 0u;
+    const char* position = file.begin();
+    ConllSentenceRef sentence;
+    while (true)
+    {
+        sentence.clear();
+        position = read_sentence(position, file.end(), sentence);
+        if (position == nullptr)
+            return n;
+
+        output.push_back(sentence);
+        ++ n;
+    }
+}
+
+}
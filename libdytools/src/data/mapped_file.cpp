@@ -0,0 +1,96 @@
+#include "dytools/data/mapped_file.h"
+
+#include <stdexcept>
+#include <cerrno>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dytools
+{
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open file: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Could not stat file: " + path);
+    }
+
+    if (!S_ISREG(st.st_mode))
+    {
+        // pipes, character devices, process substitution...: the size is not known in advance
+        // and the content can only be read once, so it is copied into an owned buffer
+        try
+        {
+            read_all(fd, path);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+    }
+    // mmap does not accept empty mappings
+    else if (st.st_size > 0)
+    {
+        void* ptr = ::mmap(nullptr, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("Could not map file: " + path);
+        }
+        // files are scanned from start to end
+        ::madvise(ptr, (std::size_t) st.st_size, MADV_SEQUENTIAL);
+
+        data = (const char*) ptr;
+        size = (std::size_t) st.st_size;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr && data != buffer.data())
+        ::munmap((void*) data, size);
+}
+
+void MappedFile::read_all(const int fd, const std::string& path)
+{
+    const std::size_t block_size = 1u << 20u;
+    std::size_t n_read = 0u;
+    while (true)
+    {
+        buffer.resize(n_read + block_size);
+        const ssize_t n = ::read(fd, buffer.data() + n_read, block_size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Could not read file: " + path);
+        }
+        if (n == 0)
+            break;
+        n_read += (std::size_t) n;
+    }
+    buffer.resize(n_read);
+    buffer.shrink_to_fit();
+
+    if (n_read > 0u)
+    {
+        data = buffer.data();
+        size = n_read;
+    }
+}
+
+}
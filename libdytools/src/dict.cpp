@@ -2,11 +2,37 @@
 
 #include <fstream>
 #include <utility>
+#include <limits>
 #include "boost/algorithm/string/trim.hpp"
 
 namespace dytools
 {
 
+namespace
+{
+
+const std::uint32_t empty_slot = std::numeric_limits<std::uint32_t>::max();
+
+// same result as to_lower with the default "C" locale
+inline char to_lower_ascii(const char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c;
+}
+
+// 64 bits FNV-1a of the (optionally lowercased) word
+inline std::uint64_t word_hash(const boost::string_ref& word, const bool lowercase)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for (const char c : word)
+    {
+        h ^= (unsigned char) (lowercase ? to_lower_ascii(c) : c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+}
+
 Dict::Dict(bool _lowercase, bool _has_num, bool _has_unk) :
     has_unk(_has_unk),
     has_num(_has_num),
@@ -37,29 +63,52 @@ std::string Dict::normalize(const std::string& word) const
         return word;
 }
 
-unsigned Dict::to_id(const std::string& _word) const
+unsigned Dict::to_id(const boost::string_ref& _word) const
 {
-    const auto word = normalize(_word);
-
-    auto it = word_to_id.find(word);
-    if (it == word_to_id.end())
+    if (frozen)
     {
-        if (has_unk)
-            return unk_id;
-        else
+        if (has_num && is_num(_word))
+            return num_id;
+
+        const std::uint64_t h = word_hash(_word, lowercase);
+        const std::size_t mask = frozen_table.size() - 1u;
+        for (std::size_t slot = h & mask ; frozen_table[slot].id != empty_slot ; slot = (slot + 1u) & mask)
         {
-            std::ostringstream msg;
-            msg << "Word not in dict: " << _word << " / normalized as: " << word;
-            throw std::runtime_error(msg.str());
+            const FrozenSlot& entry = frozen_table[slot];
+            if (entry.hash != (std::uint32_t) (h >> 32u))
+                continue;
+
+            const std::uint32_t begin = frozen_offsets[entry.id];
+            if (frozen_offsets[entry.id + 1u] - begin != _word.size())
+                continue;
+
+            bool equal = true;
+            for (std::size_t i = 0u ; i < _word.size() && equal ; ++i)
+                equal = ((lowercase ? to_lower_ascii(_word[i]) : _word[i]) == frozen_words[begin + i]);
+            if (equal)
+                return entry.id;
         }
     }
     else
-        return it->second;
+    {
+        auto it = word_to_id.find(normalize(_word.to_string()));
+        if (it != word_to_id.end())
+            return it->second;
+    }
+
+    if (has_unk)
+        return unk_id;
+    else
+    {
+        std::ostringstream msg;
+        msg << "Word not in dict: " << _word << " / normalized as: " << normalize(_word.to_string());
+        throw std::runtime_error(msg.str());
+    }
 }
 
 unsigned Dict::to_id(const char& _char) const
 {
-    return to_id(std::string(1, _char));
+    return to_id(boost::string_ref(&_char, 1u));
 }
 
 std::string Dict::to_string(const unsigned id) const
@@ -69,7 +118,13 @@ std::string Dict::to_string(const unsigned id) const
 
 void Dict::add(const std::string& _word)
 {
-    const auto word = normalize(_word);
+    add_normalized(normalize(_word));
+}
+
+void Dict::add_normalized(const std::string& word)
+{
+    if (frozen)
+        throw std::runtime_error("Cannot add a word to a frozen dict");
 
     auto it = word_to_id.find(word);
     if (it == word_to_id.end())
@@ -85,11 +140,68 @@ void Dict::add(const char& _char)
     add(std::string(1, _char));
 }
 
+void Dict::freeze()
+{
+    frozen_words.clear();
+    frozen_offsets.clear();
+    for (const auto& word : id_to_word)
+    {
+        frozen_offsets.push_back(frozen_words.size());
+        frozen_words += word;
+    }
+    frozen_offsets.push_back(frozen_words.size());
+
+    // power of two with a load factor of at most 1/2
+    std::size_t capacity = 8u;
+    while (capacity < 2u * id_to_word.size())
+        capacity *= 2u;
+    frozen_table.assign(capacity, FrozenSlot{0u, empty_slot});
+
+    // words are stored already normalized
+    const std::size_t mask = capacity - 1u;
+    for (unsigned id = 0u ; id < id_to_word.size() ; ++id)
+    {
+        const std::uint64_t h = word_hash(id_to_word[id], false);
+        std::size_t slot = h & mask;
+        while (frozen_table[slot].id != empty_slot)
+            slot = (slot + 1u) & mask;
+        frozen_table[slot] = FrozenSlot{(std::uint32_t) (h >> 32u), id};
+    }
+
+    frozen = true;
+}
+
 unsigned Dict::size() const
 {
     return (unsigned) id_to_word.size();
 }
 
+std::uint64_t Dict::hash() const
+{
+    // 64 bits FNV-1a
+    std::uint64_t h = 14695981039346656037ull;
+    auto update = [&h] (const char* data, const std::size_t size) {
+        for (std::size_t i = 0u ; i < size ; ++i)
+        {
+            h ^= (unsigned char) data[i];
+            h *= 1099511628211ull;
+        }
+    };
+
+    const char flags[3] = {(char) has_unk, (char) has_num, (char) lowercase};
+    update(flags, 3u);
+    update((const char*) &unk_id, sizeof(unk_id));
+    update((const char*) &num_id, sizeof(num_id));
+    for (const auto& word : id_to_word)
+    {
+        // the length separates consecutive words
+        const std::uint32_t length = word.size();
+        update((const char*) &length, sizeof(length));
+        update(word.data(), word.size());
+    }
+    return h;
+}
+
 void Dict::swap(dytools::Dict &other)
 {
     std::swap(has_unk, other.has_unk);
@@ -99,6 +211,10 @@ void Dict::swap(dytools::Dict &other)
     std::swap(num_id, other.num_id);
     std::swap(id_to_word, other.id_to_word);
     std::swap(word_to_id, other.word_to_id);
+    std::swap(frozen, other.frozen);
+    std::swap(frozen_words, other.frozen_words);
+    std::swap(frozen_offsets, other.frozen_offsets);
+    std::swap(frozen_table, other.frozen_table);
 }
 
 }
\ No newline at end of file
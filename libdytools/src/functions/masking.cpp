@@ -1,11 +1,80 @@
 #include "dytools/functions/masking.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
-#include <vector>
+#include <tuple>
 
 namespace dytools
 {
 
+namespace
+{
+
+typedef std::tuple<int, std::vector<unsigned>, unsigned, float> MaskKey;
+
+std::vector<float> make_mask(const MaskKind kind, const dynet::Dim& dim, const float value)
+{
+    std::vector<float> values(dim.size(), 0.f);
+    const unsigned batch_size = dim.batch_size();
+
+    switch (kind)
+    {
+        case MaskKind::MainDiagonal:
+        case MaskKind::MainDiagonalButFirst:
+        {
+            if (dim.ndims() != 2)
+                throw std::runtime_error("A diagonal mask can only be created for a matrix");
+
+            const unsigned rows = dim.rows();
+            const unsigned cols = dim.cols();
+            const unsigned n_elems = (cols < rows ? cols : rows);
+            const unsigned first = (kind == MaskKind::MainDiagonal ? 0u : 1u);
+            for (unsigned batch = 0 ; batch < dim.batch_elems() ; ++batch)
+                for (unsigned i = first ; i < n_elems ; ++i)
+                    values[i + i * rows + batch * batch_size] = value;
+            break;
+        }
+        case MaskKind::AllButFirst:
+        {
+            std::fill(values.begin() + 1, values.end(), value);
+            break;
+        }
+    }
+
+    return values;
+}
+
+}
+
+const std::vector<float>* cached_mask(const MaskKind kind, const dynet::Dim& dim, const float value)
+{
+    // masks are never removed, so pointers to them stay valid
+    static std::mutex mutex;
+    static std::map<MaskKey, std::unique_ptr<const std::vector<float>>> cache;
+
+    std::vector<unsigned> dims;
+    for (unsigned i = 0 ; i < dim.ndims() ; ++i)
+        dims.push_back(dim[i]);
+    MaskKey key((int) kind, dims, dim.batch_elems(), value);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it == cache.end())
+    {
+        std::unique_ptr<const std::vector<float>> values(new std::vector<float>(make_mask(kind, dim, value)));
+        it = cache.emplace(std::move(key), std::move(values)).first;
+    }
+    return it->second.get();
+}
+
+dynet::Expression mask(dynet::ComputationGraph& cg, const MaskKind kind, const dynet::Dim& dim, const float value)
+{
+    return dynet::input(cg, dim, cached_mask(kind, dim, value));
+}
+
 dynet::Expression main_diagonal_mask(dynet::ComputationGraph& cg, const dynet::Dim dim, const float value)
 {
     if (dim.ndims() != 2)
@@ -13,26 +82,13 @@ dynet::Expression main_diagonal_mask(dynet::ComputationGraph& cg, const dynet::D
     if (dim.batch_elems() > 1)
         throw std::runtime_error("The main diagonal mask does not support multi-batching");
 
-    const unsigned rows = dim.rows();
-    const unsigned cols = dim.cols();
-    const unsigned n_elems = (cols < rows ? cols : rows);
-
-    std::vector<unsigned> indices;
-    for (unsigned i = 0 ; i < n_elems ; ++i)
-        indices.push_back(i + i * rows);
-
-    std::vector<float> values(n_elems, value);
-
-    return dynet::input(cg, dim, indices, values);
+    return mask(cg, MaskKind::MainDiagonal, dim, value);
 }
 
 
 dynet::Expression all_but_first_vector_mask(dynet::ComputationGraph& cg, const unsigned size)
 {
-    std::vector<float> values(size, 1.f);
-    values[0] = 0.f;
-
-    return dynet::input(cg, {size}, values);
+    return mask(cg, MaskKind::AllButFirst, {size});
 }
 
-}
\ No newline at end of file
+}
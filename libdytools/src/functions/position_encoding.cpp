@@ -1,30 +1,67 @@
 #include "dytools/functions/position_encoding.h"
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace dytools
 {
 
-// from: https://github.com/clab/dynet/blob/d65bd5e0f921087f165a44b18c1f65369c9f517d/examples/transformer/transformer.h#L604
-dynet::Expression make_sinusoidal_position_encoding(dynet::ComputationGraph &cg, const dynet::Dim& dim)
+namespace
 {
-    unsigned nUnits = dim[0];
-    unsigned nWords = dim[1];
 
+// Encodings of positions [0, n_words) for a given number of units, one column per position.
+// A position does not depend on the length of the sentence,
+// so the encoding of a shorter sentence is a prefix of this table.
+void fill_sinusoidal_position_encoding(const unsigned nUnits, const unsigned first_word, const unsigned nWords, std::vector<float>& vSS)
+{
     float num_timescales = nUnits / 2;
     float log_timescale_increment = std::log(10000.f) / (num_timescales - 1.f);
 
-    std::vector<float> vSS(nUnits * nWords, 0.f);
-    for(unsigned p = 0; p < nWords; ++p) {
+    vSS.resize(nUnits * nWords, 0.f);
+    for(unsigned p = first_word; p < nWords; ++p) {
         for(int i = 0; i < num_timescales; ++i) {
             float v = p * std::exp(i * -log_timescale_increment);
             vSS[p * nUnits + i] = std::sin(v);
             vSS[p * nUnits + num_timescales + i] = std::cos(v);
         }
     }
+}
 
-    return dynet::input(cg, {nUnits, nWords}, vSS);
 }
 
-}
\ No newline at end of file
+// from: https://github.com/clab/dynet/blob/d65bd5e0f921087f165a44b18c1f65369c9f517d/examples/transformer/transformer.h#L604
+// The table of each number of units is computed for the longest sentence seen so far (grown by doubling)
+// and shared by all computation graphs: the input of a sentence reads the prefix of the largest table.
+dynet::Expression make_sinusoidal_position_encoding(dynet::ComputationGraph &cg, const dynet::Dim& dim)
+{
+    unsigned nUnits = dim[0];
+    unsigned nWords = dim[1];
+
+    static std::mutex mutex;
+    // graphs may still point to the smaller tables, so they are never removed,
+    // each table is at least twice as large as the previous one
+    static std::map<unsigned, std::vector<std::unique_ptr<const std::vector<float>>>> tables;
+
+    const std::vector<float>* values;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& unit_tables = tables[nUnits];
+        const unsigned n_computed = (unit_tables.empty() || nUnits == 0u ? 0u : unit_tables.back()->size() / nUnits);
+        if (unit_tables.empty() || (nUnits > 0u && n_computed < nWords))
+        {
+            std::unique_ptr<std::vector<float>> table(unit_tables.empty() ? new std::vector<float>() : new std::vector<float>(*unit_tables.back()));
+            fill_sinusoidal_position_encoding(nUnits, n_computed, std::max(nWords, 2u * n_computed), *table);
+            unit_tables.push_back(std::move(table));
+        }
+        values = unit_tables.back().get();
+    }
+
+    // the input node only reads the first nUnits * nWords values
+    return dynet::input(cg, {nUnits, nWords}, values);
+}
+
+}
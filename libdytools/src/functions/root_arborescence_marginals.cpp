@@ -1,102 +1,280 @@
 #include "dytools/functions/rooted_arborescence_marginals.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "dynet/dynet.h"
+#include "dynet/tensor.h"
+
 #include "dytools/utils.h"
-#include "dytools/functions/masking.h"
+#include "dytools/thread_pool.h"
 
 namespace dytools
 {
 
-dynet::Expression rooted_arborescence_marginals(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>& n_vertices)
+namespace
 {
-    return rooted_arborescence_marginals(cg, arc_weights, &n_vertices);
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+
+// Buffers for one graph, only resized.
+struct MatrixTreeWorkspace
+{
+    Matrix weights;
+    Matrix laplacian;
+    Matrix gradient;
+};
+
+// Exponentiated arc weights of the n_vertices x n_vertices block of scores (head + mod * stride).
+// Each column is shifted by its max, so the best arc entering each vertex has weight 1.
+// Self-loops and arcs entering the root are removed.
+// Returns the sum of the shifts, i.e. the value to add to the log-partition function.
+double matrix_tree_weights(const float* scores, const unsigned n_vertices, const unsigned stride, Matrix& weights)
+{
+    weights.setZero(n_vertices, n_vertices);
+
+    double shift = 0.;
+    for (unsigned m = 1u ; m < n_vertices ; ++m)
+    {
+        const float* col = scores + m * stride;
+        float max_score = -std::numeric_limits<float>::infinity();
+        for (unsigned h = 0u ; h < n_vertices ; ++h)
+            if (h != m)
+                max_score = std::max(max_score, col[h]);
+
+        for (unsigned h = 0u ; h < n_vertices ; ++h)
+            if (h != m)
+                weights(h, m) = std::exp((double) col[h] - (double) max_score);
+        shift += max_score;
+    }
+    return shift;
 }
-dynet::Expression rooted_arborescence_marginals(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>* n_vertices)
+
+// Laplacian restricted to the non-root vertices (vertex i is at index i - 1),
+// arcs from the root only appear in the diagonal.
+void matrix_tree_laplacian(const Matrix& weights, Matrix& laplacian)
+{
+    const unsigned n_vertices = weights.rows();
+    laplacian.resize(n_vertices - 1u, n_vertices - 1u);
+    for (unsigned m = 1u ; m < n_vertices ; ++m)
+    {
+        for (unsigned h = 1u ; h < n_vertices ; ++h)
+            laplacian(h - 1u, m - 1u) = -weights(h, m);
+        laplacian(m - 1u, m - 1u) = weights.col(m).sum();
+    }
+}
+
+// Derivative of log det(laplacian) with respect to the weight of arc (h, m),
+// given a matrix in the shape of the inverse Laplacian.
+inline double arc_derivative(const Matrix& inverse, const unsigned h, const unsigned m)
 {
-    const unsigned n_max_vertices = arc_weights.dim().cols();
+    return inverse(m - 1u, m - 1u) - (h == 0u ? 0. : inverse(m - 1u, h - 1u));
+}
 
-    const auto mask_diagonal = dytools::main_diagonal_mask(cg, {n_max_vertices, n_max_vertices});
-    const auto mask_first_row = all_but_first_vector_mask(cg, n_max_vertices);
-    const auto mask_first_col = dynet::transpose(mask_first_row);
-    const auto root_weight = dynet::input(cg, {n_max_vertices, n_max_vertices}, {0u}, {1.f});
+// Arc marginals or log-partition function of a batch of graphs,
+// the backward pass uses the inverse of the Laplacian stored during the forward pass.
+struct MatrixTreeNode : public dynet::Node
+{
+    std::vector<unsigned> n_vertices;
+    bool output_marginals;
 
-    auto exp_weights = dynet::exp(arc_weights);
+    MatrixTreeNode(const std::initializer_list<dynet::VariableIndex>& a, const std::vector<unsigned>& n_vertices, const bool output_marginals) :
+        dynet::Node(a),
+        n_vertices(n_vertices),
+        output_marginals(output_marginals)
+    {}
 
-    // mask
-    dynet::Expression e_t_vertices_mask;
-    if (n_vertices != nullptr)
+    std::string as_string(const std::vector<std::string>& arg_names) const override
     {
-        if (n_vertices->size() != arc_weights.dim().batch_elems())
+        return std::string(output_marginals ? "rooted_arborescence_marginals(" : "rooted_arborescence_log_partition(") + arg_names.at(0) + ")";
+    }
+
+    dynet::Dim dim_forward(const std::vector<dynet::Dim>& xs) const override
+    {
+        if (xs.size() != 1u)
+            throw std::runtime_error("The matrix-tree node expects a single input");
+        if (xs[0].ndims() != 2u || xs[0].rows() != xs[0].cols())
+            throw std::runtime_error("Arc weights must be square matrices");
+        if (n_vertices.size() != xs[0].batch_elems())
             throw std::runtime_error("Batch size does not match the graph size vector");
+        for (const unsigned n : n_vertices)
+            if (n > xs[0].rows())
+                throw std::runtime_error("Graph size is larger than the arc weight matrix");
 
-        std::vector<unsigned> v_mask_indices;
-        for (unsigned batch = 0 ; batch < n_vertices->size() ; ++batch)
-            for (unsigned i = 0 ; i < n_vertices->at(batch) ; ++i)
-                v_mask_indices.push_back(i + batch * n_max_vertices);
-        std::vector<float> v_mask_values(v_mask_indices.size(), 1.f);
-        auto e_vertices_mask = dynet::input(cg, dynet::Dim({n_max_vertices}, n_vertices->size()), v_mask_indices, v_mask_values);
-        e_t_vertices_mask = dynet::transpose(e_vertices_mask);
-
-        // mask network of invalid arcs
-        exp_weights = dynet::cmult(exp_weights, e_vertices_mask);
-        exp_weights = dynet::cmult(exp_weights, e_t_vertices_mask);
-
-        // add fake arc from the root word
-        std::vector<unsigned> v_fake_arc_indices;
-        for (unsigned batch = 0 ; batch < n_vertices->size() ; ++batch)
-        {
-            const unsigned vertices_in_batch = n_vertices->at(batch);
-            for (unsigned i = vertices_in_batch; i < n_max_vertices ; ++i)
-                v_fake_arc_indices.push_back(i * n_max_vertices + batch * n_max_vertices * n_max_vertices);
-        }
-        std::vector<float> v_fake_arc_values(v_fake_arc_indices.size(), 1.f);
-        auto e_fake_arcs = dynet::input(cg, dynet::Dim({n_max_vertices, n_max_vertices}, n_vertices->size()), v_fake_arc_indices, v_fake_arc_values);
-
-        exp_weights = exp_weights + e_fake_arcs;
+        if (output_marginals)
+            return xs[0];
+        else
+            return dynet::Dim({1u}, xs[0].batch_elems());
     }
 
-    const auto col_sum = dynet::sum_dim(exp_weights, {0});
-    const auto col_sum_as_diag = dynet::cmult(col_sum, mask_diagonal);
+    bool supports_multibatch() const override
+    {
+        return true;
+    }
 
-    const auto laplacian = col_sum_as_diag - exp_weights;
-    const auto laplacian2 = root_weight + dynet::cmult(laplacian, mask_first_row);
+    // The inverse Laplacian of each batch element is kept for the backward pass,
+    // each one is stored in a block of inverse_size() x inverse_size() doubles.
+    unsigned inverse_size() const
+    {
+        const unsigned n_max = n_vertices.empty() ? 0u : *std::max_element(n_vertices.begin(), n_vertices.end());
+        return n_max > 0u ? n_max - 1u : 0u;
+    }
 
-    // the inverse operation does not support GPU neither minibatches
-    dynet::Expression inv_laplacian;
-    if (laplacian2.dim().batch_elems() == 1)
+    double* inverse_ptr(const unsigned b) const
     {
-        inv_laplacian = dytools::force_cpu(dynet::inverse, laplacian2); // op not available on GPU
+        return (double*) aux_mem + b * inverse_size() * inverse_size();
     }
-    else
+
+    size_t aux_storage_size() const override
     {
-        std::vector<dynet::Expression> all_inv_laplacian;
-        all_inv_laplacian.reserve(laplacian2.dim().batch_elems());
-        for (unsigned b = 0 ; b < laplacian2.dim().batch_elems() ; ++b)
-        {
-            all_inv_laplacian.push_back(
-                    dytools::force_cpu(dynet::inverse, dynet::pick_batch_elem(laplacian2, b))
-            );
-        }
-        inv_laplacian = dynet::concatenate_to_batch(all_inv_laplacian);
+        return n_vertices.size() * inverse_size() * inverse_size() * sizeof(double);
     }
 
+    void forward_impl(const std::vector<const dynet::Tensor*>& xs, dynet::Tensor& fx) const override
+    {
+        const dynet::Tensor& x = *xs[0];
+        if (x.device->type != dynet::DeviceType::CPU)
+            throw std::runtime_error("The matrix-tree node is only implemented on CPU");
+
+        const unsigned n_max = x.d.rows();
+        const unsigned batch_size = x.d.batch_size();
+        // log-partition of an empty graph is 0 too
+        std::fill(fx.v, fx.v + fx.d.size(), 0.f);
 
-    const auto inv_laplacian_diag = dynet::cmult(inv_laplacian, mask_diagonal);
+        get_default_thread_pool().run((unsigned) n_vertices.size(), [&] (const unsigned b, const unsigned) {
+            // pool threads are persistent, so each of them keeps its workspace between calls
+            static thread_local MatrixTreeWorkspace ws;
+            const unsigned n = n_vertices[b];
+            if (n < 2u)
+                return;
 
-    const auto output1 = dynet::cmult(
-            exp_weights,
-            dynet::transpose(dynet::sum_dim(inv_laplacian_diag, {0}))
-    );
-    const auto output2 = dynet::cmult(exp_weights, dynet::transpose(inv_laplacian));
+            const double shift = matrix_tree_weights(x.v + b * batch_size, n, n_max, ws.weights);
+            matrix_tree_laplacian(ws.weights, ws.laplacian);
+            const Eigen::PartialPivLU<Matrix> lu(ws.laplacian);
 
-    auto marginals = dynet::cmult(output1, mask_first_col) - dynet::cmult(output2, mask_first_row);
+            // every entry of the inverse is needed by the marginals, it is obtained from the LU factors
+            Eigen::Map<Matrix> inverse(inverse_ptr(b), n - 1u, n - 1u);
+            inverse = lu.inverse();
 
+            if (!output_marginals)
+            {
+                // log-determinant from the diagonal of U (the determinant of a Laplacian is non-negative),
+                // plus the shifts of the scores
+                fx.v[b] = (float) (shift + lu.matrixLU().diagonal().array().abs().log().sum());
+                return;
+            }
 
-    if (n_vertices != nullptr)
+            float* marginals = fx.v + b * batch_size;
+            for (unsigned m = 1u ; m < n ; ++m)
+                for (unsigned h = 0u ; h < n ; ++h)
+                    if (h != m)
+                        marginals[h + m * n_max] = (float) (ws.weights(h, m) * arc_derivative(inverse, h, m));
+        });
+    }
+
+    void backward_impl(
+            const std::vector<const dynet::Tensor*>& xs,
+            const dynet::Tensor& fx,
+            const dynet::Tensor& dEdf,
+            unsigned,
+            dynet::Tensor& dEdxi
+    ) const override
     {
-        marginals = dynet::cmult(marginals, e_t_vertices_mask);
+        const dynet::Tensor& x = *xs[0];
+        const unsigned n_max = x.d.rows();
+        const unsigned batch_size = x.d.batch_size();
+
+        get_default_thread_pool().run((unsigned) n_vertices.size(), [&] (const unsigned b, const unsigned) {
+            static thread_local MatrixTreeWorkspace ws;
+            const unsigned n = n_vertices[b];
+            if (n < 2u)
+                return;
+
+            matrix_tree_weights(x.v + b * batch_size, n, n_max, ws.weights);
+            const Eigen::Map<const Matrix> inverse(inverse_ptr(b), n - 1u, n - 1u);
+            float* d_scores = dEdxi.v + b * batch_size;
+
+            if (!output_marginals)
+            {
+                // the gradient of the log-partition function is the vector of marginals
+                const double g = dEdf.v[b];
+                for (unsigned m = 1u ; m < n ; ++m)
+                    for (unsigned h = 0u ; h < n ; ++h)
+                        if (h != m)
+                            d_scores[h + m * n_max] += (float) (g * ws.weights(h, m) * arc_derivative(inverse, h, m));
+                return;
+            }
+
+            // With K(h, m) = inverse(m, m) - inverse(m, h), marginals are mu = W * K (elementwise).
+            // Since d inverse = - inverse * d laplacian * inverse, the contribution of K to the gradient
+            // is - W(h, m) * (P(m, m) - P(m, h)) where P = inverse * L' * inverse
+            // and L' is the Laplacian built from the weights G * W.
+            const float* d_marginals = dEdf.v + b * batch_size;
+            const float* marginals = fx.v + b * batch_size;
+
+            ws.gradient.setZero(n, n);
+            for (unsigned m = 1u ; m < n ; ++m)
+                for (unsigned h = 0u ; h < n ; ++h)
+                    if (h != m)
+                        ws.gradient(h, m) = d_marginals[h + m * n_max] * ws.weights(h, m);
+            matrix_tree_laplacian(ws.gradient, ws.laplacian);
+            ws.gradient.noalias() = inverse * ws.laplacian;
+            ws.laplacian.noalias() = ws.gradient * inverse;
+
+            for (unsigned m = 1u ; m < n ; ++m)
+            {
+                for (unsigned h = 0u ; h < n ; ++h)
+                {
+                    if (h == m)
+                        continue;
+                    const unsigned i = h + m * n_max;
+                    d_scores[i] += (float) (d_marginals[i] * marginals[i] - ws.weights(h, m) * arc_derivative(ws.laplacian, h, m));
+                }
+            }
+        });
     }
+};
+
+dynet::Expression matrix_tree(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>* n_vertices, const bool output_marginals)
+{
+    std::vector<unsigned> all_n_vertices;
+    if (n_vertices != nullptr)
+        all_n_vertices = *n_vertices;
+    else
+        all_n_vertices.assign(arc_weights.dim().batch_elems(), arc_weights.dim().rows());
+
+    return dytools::force_cpu(
+            [&] (const dynet::Expression& cpu_weights) {
+                return dynet::Expression(&cg, cg.add_function<MatrixTreeNode>({cpu_weights.i}, all_n_vertices, output_marginals));
+            },
+            arc_weights
+    );
+}
 
-    return marginals;
 }
 
-}
\ No newline at end of file
+dynet::Expression rooted_arborescence_marginals(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>& n_vertices)
+{
+    return rooted_arborescence_marginals(cg, arc_weights, &n_vertices);
+}
+
+dynet::Expression rooted_arborescence_marginals(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>* n_vertices)
+{
+    return matrix_tree(cg, arc_weights, n_vertices, true);
+}
+
+dynet::Expression rooted_arborescence_log_partition(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>& n_vertices)
+{
+    return rooted_arborescence_log_partition(cg, arc_weights, &n_vertices);
+}
+
+dynet::Expression rooted_arborescence_log_partition(dynet::ComputationGraph& cg, const dynet::Expression& arc_weights, const std::vector<unsigned>* n_vertices)
+{
+    return matrix_tree(cg, arc_weights, n_vertices, false);
+}
+
+}
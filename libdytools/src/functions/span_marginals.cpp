@@ -0,0 +1,152 @@
+#include "dytools/functions/span_marginals.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "dynet/dynet.h"
+#include "dynet/tensor.h"
+
+#include "dytools/utils.h"
+#include "dytools/thread_pool.h"
+#include "dytools/algorithms/span-parser.h"
+
+namespace dytools
+{
+
+namespace
+{
+
+// Inside-outside nodes over a batch of padded sentences.
+// Batch elements are independent, they are processed in parallel on the default thread pool.
+struct SpanInsideOutsideNode : public dynet::Node
+{
+    std::vector<unsigned> n_words;
+    bool output_marginals;
+
+    SpanInsideOutsideNode(const std::initializer_list<dynet::VariableIndex>& a, const std::vector<unsigned>& n_words, const bool output_marginals) :
+        dynet::Node(a),
+        n_words(n_words),
+        output_marginals(output_marginals)
+    {}
+
+    std::string as_string(const std::vector<std::string>& arg_names) const override
+    {
+        return std::string(output_marginals ? "span_marginals(" : "span_log_partition(") + arg_names.at(0) + ")";
+    }
+
+    dynet::Dim dim_forward(const std::vector<dynet::Dim>& xs) const override
+    {
+        if (xs.size() != 1u)
+            throw std::runtime_error("Span inside-outside expects a single input");
+        if (xs[0].ndims() != 2u || xs[0].rows() != xs[0].cols())
+            throw std::runtime_error("Span weights must be square matrices");
+        if (n_words.size() != xs[0].batch_elems())
+            throw std::runtime_error("Batch size does not match the sentence size vector");
+        for (const unsigned n : n_words)
+            if (n > xs[0].rows())
+                throw std::runtime_error("Sentence size is larger than the span weight matrix");
+
+        if (output_marginals)
+            return xs[0];
+        else
+            return dynet::Dim({1u}, xs[0].batch_elems());
+    }
+
+    bool supports_multibatch() const override
+    {
+        return true;
+    }
+
+    // marginals of batch element b are written with the same layout as the input
+    void run(const dynet::Tensor& x, float* log_partition, float* marginals) const
+    {
+        if (x.device->type != dynet::DeviceType::CPU)
+            throw std::runtime_error("Span inside-outside is only implemented on CPU");
+
+        const unsigned n_max_words = x.d.rows();
+        const unsigned batch_size = x.d.batch_size();
+        if (marginals != nullptr)
+            std::fill(marginals, marginals + x.d.size(), 0.f);
+
+        get_default_thread_pool().run((unsigned) n_words.size(), [&] (const unsigned b, const unsigned) {
+            // pool threads are persistent, so each of them keeps its workspace between calls
+            static thread_local SpanParserWorkspace workspace;
+            const ScoreMatrix weights(x.v + b * batch_size, n_words[b], n_words[b], n_max_words);
+            const float value = span_inside_outside(weights, workspace, marginals == nullptr ? nullptr : marginals + b * batch_size);
+            if (log_partition != nullptr)
+                log_partition[b] = value;
+        });
+    }
+
+    void forward_impl(const std::vector<const dynet::Tensor*>& xs, dynet::Tensor& fx) const override
+    {
+        if (output_marginals)
+            run(*xs[0], nullptr, fx.v);
+        else
+            run(*xs[0], fx.v, nullptr);
+    }
+
+    void backward_impl(
+            const std::vector<const dynet::Tensor*>& xs,
+            const dynet::Tensor&,
+            const dynet::Tensor& dEdf,
+            unsigned,
+            dynet::Tensor& dEdxi
+    ) const override
+    {
+        if (output_marginals)
+            throw std::runtime_error("Span marginals are not differentiable, use span_log_partition instead");
+
+        // the gradient of the log-partition function is the vector of marginals
+        std::vector<float> marginals(xs[0]->d.size());
+        run(*xs[0], nullptr, marginals.data());
+
+        const unsigned batch_size = xs[0]->d.batch_size();
+        for (unsigned b = 0u ; b < n_words.size() ; ++b)
+        {
+            const float g = dEdf.v[b];
+            for (unsigned i = 0u ; i < batch_size ; ++i)
+                dEdxi.v[i + b * batch_size] += g * marginals[i + b * batch_size];
+        }
+    }
+};
+
+dynet::Expression span_inside_outside(dynet::ComputationGraph& cg, const dynet::Expression& span_weights, const std::vector<unsigned>* n_words, const bool output_marginals)
+{
+    std::vector<unsigned> all_n_words;
+    if (n_words != nullptr)
+        all_n_words = *n_words;
+    else
+        all_n_words.assign(span_weights.dim().batch_elems(), span_weights.dim().rows());
+
+    return dytools::force_cpu(
+            [&] (const dynet::Expression& cpu_weights) {
+                return dynet::Expression(&cg, cg.add_function<SpanInsideOutsideNode>({cpu_weights.i}, all_n_words, output_marginals));
+            },
+            span_weights
+    );
+}
+
+}
+
+dynet::Expression span_log_partition(dynet::ComputationGraph& cg, const dynet::Expression& span_weights, const std::vector<unsigned>& n_words)
+{
+    return span_log_partition(cg, span_weights, &n_words);
+}
+
+dynet::Expression span_log_partition(dynet::ComputationGraph& cg, const dynet::Expression& span_weights, const std::vector<unsigned>* n_words)
+{
+    return span_inside_outside(cg, span_weights, n_words, false);
+}
+
+dynet::Expression span_marginals(dynet::ComputationGraph& cg, const dynet::Expression& span_weights, const std::vector<unsigned>& n_words)
+{
+    return span_marginals(cg, span_weights, &n_words);
+}
+
+dynet::Expression span_marginals(dynet::ComputationGraph& cg, const dynet::Expression& span_weights, const std::vector<unsigned>* n_words)
+{
+    return span_inside_outside(cg, span_weights, n_words, true);
+}
+
+}
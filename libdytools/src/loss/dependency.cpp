@@ -1,19 +1,169 @@
 #include "dytools/loss/dependency.h"
+#include "dytools/functions/masking.h"
+#include "dytools/functions/rooted_arborescence_marginals.h"
+#include "dytools/algorithms/dependency-parser.h"
+#include "dytools/thread_pool.h"
+#include "dytools/utils.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "dynet/dynet.h"
+#include "dynet/tensor.h"
 
 namespace dytools
 {
 
+namespace
+{
+
+// Structured hinge loss of a batch of padded sentences, one output per sentence.
+// The forward pass decodes the cost-augmented trees, which are kept for the backward pass.
+struct TreeHingeLossNode : public dynet::Node
+{
+    std::vector<std::vector<unsigned>> gold_heads;
+    float cost;
+
+    TreeHingeLossNode(const std::initializer_list<dynet::VariableIndex>& a, const std::vector<std::vector<unsigned>>& gold_heads, const float cost) :
+        dynet::Node(a),
+        gold_heads(gold_heads),
+        cost(cost)
+    {}
+
+    std::string as_string(const std::vector<std::string>& arg_names) const override
+    {
+        return "head_max_margin_loss(" + arg_names.at(0) + ")";
+    }
+
+    dynet::Dim dim_forward(const std::vector<dynet::Dim>& xs) const override
+    {
+        if (xs.size() != 1u)
+            throw std::runtime_error("The hinge loss node expects a single input");
+        if (xs[0].ndims() != 2u || xs[0].rows() != xs[0].cols())
+            throw std::runtime_error("Arc weights must be square matrices");
+        if (gold_heads.size() != xs[0].batch_elems())
+            throw std::runtime_error("Arc weights do not match the number of sentences");
+        for (const auto& heads : gold_heads)
+        {
+            if (heads.size() > xs[0].rows())
+                throw std::runtime_error("Sentence is longer than the arc weight matrix");
+            for (unsigned m = 1u ; m < heads.size() ; ++m)
+                if (heads[m] >= heads.size() || heads[m] == m)
+                    throw std::runtime_error("Invalid gold head");
+        }
+
+        return dynet::Dim({1u}, xs[0].batch_elems());
+    }
+
+    bool supports_multibatch() const override
+    {
+        return true;
+    }
+
+    // predicted heads, max_size() per sentence
+    unsigned max_size() const
+    {
+        unsigned n_max = 0u;
+        for (const auto& heads : gold_heads)
+            n_max = std::max(n_max, (unsigned) heads.size());
+        return n_max;
+    }
+
+    size_t aux_storage_size() const override
+    {
+        return gold_heads.size() * max_size() * sizeof(int);
+    }
+
+    void forward_impl(const std::vector<const dynet::Tensor*>& xs, dynet::Tensor& fx) const override
+    {
+        const dynet::Tensor& x = *xs[0];
+        if (x.device->type != dynet::DeviceType::CPU)
+            throw std::runtime_error("The hinge loss node is only implemented on CPU");
+
+        const unsigned n_max = x.d.rows();
+        const unsigned batch_size = x.d.batch_size();
+        int* predicted_heads = (int*) aux_mem;
+        const unsigned aux_stride = max_size();
+
+        // longest sentences first to balance the load
+        std::vector<unsigned> order(gold_heads.size());
+        for (unsigned i = 0u ; i < order.size() ; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&] (const unsigned a, const unsigned b) {
+            return gold_heads[a].size() > gold_heads[b].size();
+        });
+
+        get_default_thread_pool().run((unsigned) order.size(), [&] (const unsigned task, const unsigned) {
+            // pool threads are persistent, so each of them keeps its buffers between calls
+            static thread_local ArborescenceWorkspace workspace;
+            static thread_local std::vector<float> scores;
+            static thread_local std::vector<int> heads;
+
+            const unsigned b = order[task];
+            const auto& gold = gold_heads[b];
+            const unsigned n = gold.size();
+            fx.v[b] = 0.f;
+            if (n < 2u)
+                return;
+
+            // cost-augmented weights, as a dense n x n matrix
+            const float* weights = x.v + b * batch_size;
+            scores.resize(n * n);
+            float gold_score = 0.f;
+            for (unsigned m = 0u ; m < n ; ++m)
+            {
+                for (unsigned h = 0u ; h < n ; ++h)
+                    scores[h + m * n] = weights[h + m * n_max] + (m > 0u && h != gold[m] ? cost : 0.f);
+                if (m > 0u)
+                    gold_score += weights[gold[m] + m * n_max];
+            }
+
+            float value = 0.f;
+            RunTarjan(n, scores.data(), &workspace, &heads, &value);
+
+            std::copy(heads.begin(), heads.begin() + n, predicted_heads + b * aux_stride);
+            fx.v[b] = std::max(0.f, value - gold_score);
+        });
+    }
+
+    void backward_impl(
+            const std::vector<const dynet::Tensor*>& xs,
+            const dynet::Tensor&,
+            const dynet::Tensor& dEdf,
+            unsigned,
+            dynet::Tensor& dEdxi
+    ) const override
+    {
+        const unsigned n_max = xs[0]->d.rows();
+        const unsigned batch_size = xs[0]->d.batch_size();
+        const int* predicted_heads = (const int*) aux_mem;
+        const unsigned aux_stride = max_size();
+
+        // sub-gradient: +1 on predicted arcs, -1 on gold arcs
+        for (unsigned b = 0u ; b < gold_heads.size() ; ++b)
+        {
+            const float g = dEdf.v[b];
+            float* d_weights = dEdxi.v + b * batch_size;
+            const auto& gold = gold_heads[b];
+            for (unsigned m = 1u ; m < gold.size() ; ++m)
+            {
+                d_weights[predicted_heads[b * aux_stride + m] + m * n_max] += g;
+                d_weights[gold[m] + m * n_max] -= g;
+            }
+        }
+    }
+};
+
+}
+
 dynet::Expression head_neg_log_likelihood(const dynet::Expression& input, const std::vector<unsigned> &heads)
 {
     const unsigned size = heads.size();
     dynet::ComputationGraph& cg = *(input.pg);
 
     // mask the diagonal
-    std::vector<unsigned> diag_idx;
-    for (unsigned i = 1u; i < size; ++i)
-        diag_idx.push_back(i + i * size);
-    std::vector<float> diag_values(diag_idx.size(), -std::numeric_limits<float>::infinity());
-    const auto diag_mask = dynet::input(cg, {size, size}, diag_idx, diag_values);
+    const auto diag_mask = mask(cg, MaskKind::MainDiagonalButFirst, {size, size}, -std::numeric_limits<float>::infinity());
 
     const auto masked_weights = input + diag_mask;
 
@@ -22,12 +172,87 @@ dynet::Expression head_neg_log_likelihood(const dynet::Expression& input, const
     const auto batched_loss = dynet::pickneglogsoftmax(batched_weights, heads);
 
     // mask the loss of the root word
-    std::vector<float> loss_mask_values(size, 1.f);
-    loss_mask_values.at(0u) = 0.f;
-    const auto masked_loss = batched_loss * dynet::input(cg, dynet::Dim({1u}, size), loss_mask_values);
+    const auto masked_loss = batched_loss * mask(cg, MaskKind::AllButFirst, dynet::Dim({1u}, size));
+
+    return dynet::sum_batches(masked_loss);
+}
+
+dynet::Expression head_neg_log_likelihood(const dynet::Expression& input, const std::vector<std::vector<unsigned>> &heads)
+{
+    const unsigned n_max = input.dim().rows();
+    const unsigned batch_size = heads.size();
+    if (input.dim().cols() != n_max || input.dim().batch_elems() != batch_size)
+        throw std::runtime_error("Arc weights do not match the number of sentences");
+    dynet::ComputationGraph& cg = *(input.pg);
+
+    // Each column is a distribution over heads: self-loops and padding heads are masked.
+    // Columns of root words and of padding are left as is (they would only contain -inf),
+    // their loss is masked instead.
+    std::vector<unsigned> arc_mask_idx;
+    std::vector<unsigned> gold_heads(n_max * batch_size, 0u);
+    std::vector<float> loss_mask_values(n_max * batch_size, 0.f);
+    for (unsigned b = 0u; b < batch_size; ++b)
+    {
+        const unsigned size = heads.at(b).size();
+        if (size > n_max)
+            throw std::runtime_error("Sentence is longer than the arc weight matrix");
+
+        for (unsigned m = 1u; m < size; ++m)
+        {
+            const unsigned col = m + b * n_max;
+            arc_mask_idx.push_back(m + col * n_max);
+            for (unsigned h = size; h < n_max; ++h)
+                arc_mask_idx.push_back(h + col * n_max);
+
+            gold_heads.at(col) = heads.at(b).at(m);
+            loss_mask_values.at(col) = 1.f;
+        }
+    }
+    std::vector<float> arc_mask_values(arc_mask_idx.size(), -std::numeric_limits<float>::infinity());
+    const auto arc_mask = dynet::input(cg, dynet::Dim({n_max, n_max}, batch_size), arc_mask_idx, arc_mask_values);
+
+    // one batch element per column of each sentence
+    const auto batched_weights = dynet::reshape(input + arc_mask, dynet::Dim({n_max}, n_max * batch_size));
+    const auto batched_loss = dynet::pickneglogsoftmax(batched_weights, gold_heads);
+
+    const auto masked_loss = batched_loss * dynet::input(cg, dynet::Dim({1u}, n_max * batch_size), loss_mask_values);
 
     return dynet::sum_batches(masked_loss);
 }
 
+dynet::Expression head_tree_crf_loss(const dynet::Expression& input, const std::vector<unsigned> &heads)
+{
+    const unsigned size = heads.size();
+    dynet::ComputationGraph& cg = *(input.pg);
 
-}
\ No newline at end of file
+    // score of the gold tree, the root word has no head
+    std::vector<unsigned> gold_idx;
+    for (unsigned i = 1u; i < size; ++i)
+        gold_idx.push_back(heads.at(i) + i * size);
+    std::vector<float> gold_values(gold_idx.size(), 1.f);
+    const auto gold_mask = dynet::input(cg, {size, size}, gold_idx, gold_values);
+    const auto gold_score = dynet::sum_elems(dynet::cmult(input, gold_mask));
+
+    return rooted_arborescence_log_partition(cg, input) - gold_score;
+}
+
+dynet::Expression head_max_margin_loss(const dynet::Expression& input, const std::vector<unsigned> &heads, const float cost)
+{
+    return head_max_margin_loss(input, std::vector<std::vector<unsigned>>{heads}, cost);
+}
+
+dynet::Expression head_max_margin_loss(const dynet::Expression& input, const std::vector<std::vector<unsigned>> &heads, const float cost)
+{
+    dynet::ComputationGraph& cg = *(input.pg);
+
+    const auto loss = dytools::force_cpu(
+            [&] (const dynet::Expression& cpu_input) {
+                return dynet::Expression(&cg, cg.add_function<TreeHingeLossNode>({cpu_input.i}, heads, cost));
+            },
+            input
+    );
+    return dynet::sum_batches(loss);
+}
+
+
+}
@@ -0,0 +1,200 @@
+#include "dytools/model_bundle.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "dynet/devices.h"
+#include "dynet/tensor.h"
+
+namespace dytools
+{
+
+namespace
+{
+
+const char model_bundle_magic[8] = {'D', 'Y', 'B', 'U', 'N', 'D', 'L', 'E'};
+const std::uint32_t model_bundle_version = 1u;
+const std::uint64_t model_bundle_alignment = 64u;
+const unsigned model_bundle_max_dims = sizeof(ModelBundleParameter::dims) / sizeof(std::uint32_t);
+
+inline std::uint64_t align(const std::uint64_t offset)
+{
+    return (offset + model_bundle_alignment - 1u) / model_bundle_alignment * model_bundle_alignment;
+}
+
+void write_padding(std::ofstream& os, const std::uint64_t offset)
+{
+    const std::uint64_t position = (std::uint64_t) os.tellp();
+    const std::vector<char> padding(offset - position, 0);
+    os.write(padding.data(), padding.size());
+}
+
+inline bool in_file(const MappedFile& file, const std::uint64_t offset, const std::uint64_t size)
+{
+    return offset <= file.size && size <= file.size - offset;
+}
+
+const ModelBundleHeader* read_header(const MappedFile& file, const std::string& path)
+{
+    if (file.size < sizeof(ModelBundleHeader) || std::memcmp(file.data, model_bundle_magic, sizeof(model_bundle_magic)) != 0)
+        throw std::runtime_error("Not a model bundle: " + path);
+
+    const ModelBundleHeader* header = (const ModelBundleHeader*) file.data;
+    if (header->version != model_bundle_version)
+        throw std::runtime_error("Unsupported model bundle version: " + path);
+    if (
+            !in_file(file, header->metadata, header->metadata_size)
+            || header->parameters % model_bundle_alignment != 0u
+            || !in_file(file, header->parameters, (std::uint64_t) header->n_parameters * sizeof(ModelBundleParameter))
+            || !in_file(file, header->names, header->names_size)
+    )
+        throw std::runtime_error("Corrupted model bundle: " + path);
+    return header;
+}
+
+void copy_values(const ModelBundleParameter& parameter, const char* data, dynet::Tensor& values)
+{
+    const float* begin = (const float*) (data + parameter.values);
+    if (values.device->type == dynet::DeviceType::CPU)
+        std::memcpy(values.v, begin, parameter.n_values * sizeof(float));
+    else
+        dynet::TensorTools::set_elements(values, std::vector<float>(begin, begin + parameter.n_values));
+}
+
+}
+
+ModelBundleWriter::ModelBundleWriter() :
+    oarchive(metadata)
+{}
+
+void ModelBundleWriter::save_parameters(const dynet::ParameterCollection& pc)
+{
+    for (const auto& p : pc.parameters_list())
+        parameters.push_back(Parameter{p->name, false, p->dim, dynet::as_vector(p->values)});
+    for (const auto& p : pc.lookup_parameters_list())
+        parameters.push_back(Parameter{p->name, true, p->all_dim, dynet::as_vector(p->all_values)});
+}
+
+void ModelBundleWriter::write(const std::string& path)
+{
+    const std::string serialized_metadata = metadata.str();
+
+    std::vector<ModelBundleParameter> table(parameters.size());
+    std::string names;
+
+    ModelBundleHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, model_bundle_magic, sizeof(model_bundle_magic));
+    header.version = model_bundle_version;
+    header.n_parameters = parameters.size();
+    header.metadata = sizeof(header);
+    header.metadata_size = serialized_metadata.size();
+    header.parameters = align(header.metadata + header.metadata_size);
+
+    for (unsigned i = 0u ; i < parameters.size() ; ++i)
+    {
+        const auto& parameter = parameters.at(i);
+        auto& entry = table.at(i);
+        std::memset(&entry, 0, sizeof(entry));
+
+        if (parameter.dim.nd > model_bundle_max_dims)
+            throw std::runtime_error("Parameter has too many dimensions: " + parameter.name);
+        entry.name = names.size();
+        entry.name_size = parameter.name.size();
+        entry.lookup = parameter.lookup;
+        entry.n_dims = parameter.dim.nd;
+        for (unsigned d = 0u ; d < parameter.dim.nd ; ++d)
+            entry.dims[d] = parameter.dim.d[d];
+        entry.n_values = parameter.values.size();
+        names += parameter.name;
+    }
+    header.names = header.parameters + table.size() * sizeof(ModelBundleParameter);
+    header.names_size = names.size();
+
+    std::uint64_t offset = header.names + header.names_size;
+    for (auto& entry : table)
+    {
+        entry.values = align(offset);
+        offset = entry.values + entry.n_values * sizeof(float);
+    }
+
+    std::ofstream os(path, std::ios::binary);
+    if (!os.is_open())
+        throw std::runtime_error("Could not open file: " + path);
+
+    os.write((const char*) &header, sizeof(header));
+    os.write(serialized_metadata.data(), serialized_metadata.size());
+    write_padding(os, header.parameters);
+    os.write((const char*) table.data(), table.size() * sizeof(ModelBundleParameter));
+    os.write(names.data(), names.size());
+    for (unsigned i = 0u ; i < parameters.size() ; ++i)
+    {
+        write_padding(os, table.at(i).values);
+        os.write((const char*) parameters.at(i).values.data(), parameters.at(i).values.size() * sizeof(float));
+    }
+
+    if (!os)
+        throw std::runtime_error("Could not write file: " + path);
+}
+
+ModelBundleLoader::MemoryBuffer::MemoryBuffer(const char* begin, const char* end)
+{
+    // the buffer is never written to, the cast is required by the std::streambuf interface
+    setg((char*) begin, (char*) begin, (char*) end);
+}
+
+ModelBundleLoader::ModelBundleLoader(const std::string& path) :
+    file(path),
+    header(read_header(file, path)),
+    buffer(file.data + header->metadata, file.data + header->metadata + header->metadata_size),
+    iarchive(buffer)
+{}
+
+void ModelBundleLoader::populate(dynet::ParameterCollection& pc) const
+{
+    const auto& pc_parameters = pc.parameters_list();
+    const auto& pc_lookup_parameters = pc.lookup_parameters_list();
+    if (pc_parameters.size() + pc_lookup_parameters.size() != header->n_parameters)
+        throw std::runtime_error("The model bundle does not have the same number of parameters as the network");
+
+    const ModelBundleParameter* table = (const ModelBundleParameter*) (file.data + header->parameters);
+    const char* names = file.data + header->names;
+
+    // checks name, kind, dimensions and bounds of the i-th entry of the bundle
+    auto entry = [&] (const unsigned i, const std::string& name, const bool lookup, const dynet::Dim& dim) -> const ModelBundleParameter&
+    {
+        const auto& parameter = table[i];
+        if (
+                parameter.name > header->names_size
+                || parameter.name_size > header->names_size - parameter.name
+                || parameter.values % model_bundle_alignment != 0u
+                || parameter.n_values > (file.size / sizeof(float))
+                || !in_file(file, parameter.values, parameter.n_values * sizeof(float))
+        )
+            throw std::runtime_error("Corrupted model bundle");
+
+        const std::string bundle_name(names + parameter.name, parameter.name_size);
+        bool same_dims = (parameter.lookup == (std::uint32_t) lookup && parameter.n_dims == dim.nd && parameter.n_values == dim.size());
+        for (unsigned d = 0u ; same_dims && d < dim.nd ; ++d)
+            same_dims = (parameter.dims[d] == dim.d[d]);
+        if (bundle_name != name || !same_dims)
+            throw std::runtime_error("Parameter mismatch between the model bundle and the network: " + name);
+        return parameter;
+    };
+
+    unsigned i = 0u;
+    for (const auto& p : pc_parameters)
+        copy_values(entry(i++, p->name, false, p->dim), file.data, p->values);
+    for (const auto& p : pc_lookup_parameters)
+        copy_values(entry(i++, p->name, true, p->all_dim), file.data, p->all_values);
+}
+
+bool is_model_bundle(const std::string& path)
+{
+    std::ifstream is(path, std::ios::binary);
+    char magic[sizeof(model_bundle_magic)];
+    return is.read(magic, sizeof(magic)) && std::memcmp(magic, model_bundle_magic, sizeof(magic)) == 0;
+}
+
+}
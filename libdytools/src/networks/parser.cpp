@@ -1,8 +1,10 @@
 #include "dytools/networks/dependency.h"
 
+#include <algorithm>
 #include <limits>
 #include <dytools/training.h>
 #include <dytools/algorithms/dependency-parser.h>
+#include <dytools/utils.h>
 
 namespace dytools
 {
@@ -11,7 +13,7 @@ DependencyNetwork::DependencyNetwork(
         dynet::ParameterCollection& pc,
         const DependencySettings& settings,
         std::shared_ptr<dytools::Dict> token_dict,
-        std::shared_ptr<dytools::Dict> char_dict,
+        std::shared_ptr<dytools::CharDict> char_dict,
         std::shared_ptr<dytools::Dict> tagger_dict,
         std::shared_ptr<dytools::Dict> label_dict
 ) :
@@ -41,19 +43,40 @@ unsigned DependencyNetwork::get_embeddings_size() const
 
 float DependencyParserEvaluator::operator()(BaseDependencyNetwork* network, const std::vector<dytools::ConllSentence>& data) const
 {
+    auto& pool = get_default_thread_pool();
+
     auto n_correct = 0.f;
     auto total = 0.f;
-    for (auto const& sentence : data)
+    for (unsigned begin = 0u ; begin < data.size() ; begin += batch_size)
     {
+        const unsigned end = std::min(begin + batch_size, (unsigned) data.size());
+
         dynet::ComputationGraph cg;
         network->new_graph(cg, false, false); // no training, do not update
 
-        const auto e_weights = std::get<1>(network->logits(sentence));
-        const auto v_weights = as_vector(cg.forward(e_weights));
+        std::vector<dynet::Expression> e_weights;
+        for (unsigned i = begin ; i < end ; ++i)
+            e_weights.push_back(std::get<1>(network->logits(data.at(i))));
+        cg.forward(e_weights.back());
+
+        // scores are read in place from the computation graph (only copied when they live on a GPU)
+        std::vector<unsigned> sizes;
+        std::vector<std::vector<float>> buffers(end - begin);
+        std::vector<const float*> p_weights;
+        for (unsigned i = begin ; i < end ; ++i)
+        {
+            sizes.push_back(data.at(i).size());
+            p_weights.push_back(as_score_matrix(cg.get_value(e_weights.at(i - begin)), buffers.at(i - begin)).data);
+        }
+
+        std::vector<std::vector<unsigned>> heads;
+        dependency_parser(decoder, sizes, p_weights, heads, pool);
 
-        const auto heads = non_projective_dependency_parser(sentence.size(), v_weights);
-        n_correct += uas(sentence, heads, false);
-        total += sentence.size();
+        for (unsigned i = begin ; i < end ; ++i)
+        {
+            n_correct += uas(data.at(i), heads.at(i - begin), false);
+            total += data.at(i).size();
+        }
     }
 
     const float score =  n_correct / total;
@@ -0,0 +1,123 @@
+#include "dytools/thread_pool.h"
+
+namespace dytools
+{
+
+ThreadPool::ThreadPool(unsigned n_threads) :
+    next_task(0u)
+{
+    if (n_threads == 0u)
+        n_threads = std::thread::hardware_concurrency();
+    if (n_threads == 0u)
+        n_threads = 1u;
+
+    threads.reserve(n_threads - 1u);
+    for (unsigned i = 1u ; i < n_threads ; ++i)
+        threads.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    start_cv.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+unsigned ThreadPool::size() const
+{
+    return (unsigned) threads.size() + 1u;
+}
+
+void ThreadPool::run(const unsigned _n_tasks, const std::function<void(unsigned, unsigned)>& f)
+{
+    if (_n_tasks == 0u)
+        return;
+
+    if (threads.size() == 0u || _n_tasks == 1u)
+    {
+        for (unsigned i = 0u ; i < _n_tasks ; ++i)
+            f(i, 0u);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &f;
+        n_tasks = _n_tasks;
+        next_task = 0u;
+        n_running = (unsigned) threads.size();
+        error = nullptr;
+        ++ generation;
+    }
+    start_cv.notify_all();
+
+    work(0u);
+
+    std::exception_ptr e;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this] { return n_running == 0u; });
+        job = nullptr;
+        std::swap(e, error);
+    }
+    if (e)
+        std::rethrow_exception(e);
+}
+
+void ThreadPool::work(const unsigned thread_id)
+{
+    while (true)
+    {
+        const unsigned task = next_task++;
+        if (task >= n_tasks)
+            break;
+
+        try
+        {
+            (*job)(task, thread_id);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+            next_task = n_tasks;
+        }
+    }
+}
+
+void ThreadPool::worker(const unsigned thread_id)
+{
+    unsigned seen_generation = 0u;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [this, seen_generation] { return stop || generation != seen_generation; });
+            if (stop)
+                return;
+            seen_generation = generation;
+        }
+
+        work(thread_id);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            -- n_running;
+            if (n_running == 0u)
+                done_cv.notify_one();
+        }
+    }
+}
+
+ThreadPool& get_default_thread_pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+}
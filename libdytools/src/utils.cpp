@@ -10,14 +10,62 @@ namespace dytools
 const boost::regex regex_num("[0-9]+|[0-9]+\\.[0-9]+|[0-9]+[0-9,]+");
 const boost::regex regex_punct("[[:punct:]]+");
 
-bool is_num(const std::string& s)
+namespace
 {
-    return boost::regex_match(s, regex_num);
+
+inline bool is_digit_char(const char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// [[:punct:]] in the default "C" locale: printable ASCII characters that are neither alphanumeric nor space
+inline bool is_punct_char(const char c)
+{
+    const unsigned char u = (unsigned char) c;
+    return (u >= 33u && u <= 47u) || (u >= 58u && u <= 64u) || (u >= 91u && u <= 96u) || (u >= 123u && u <= 126u);
+}
+
+}
+
+// same language as regex_num, without the regex engine:
+// a digit, then either only digits and commas, or digits, a dot and at least one digit
+bool is_num(const boost::string_ref& s)
+{
+    if (s.empty() || !is_digit_char(s[0]))
+        return false;
+
+    std::size_t i = 1u;
+    while (i < s.size() && is_digit_char(s[i]))
+        ++ i;
+    if (i == s.size())
+        return true;
+
+    if (s[i] == '.')
+    {
+        ++ i;
+        if (i == s.size())
+            return false;
+        for (; i < s.size() ; ++i)
+            if (!is_digit_char(s[i]))
+                return false;
+        return true;
+    }
+
+    for (; i < s.size() ; ++i)
+        if (!is_digit_char(s[i]) && s[i] != ',')
+            return false;
+    return true;
 }
 
-bool is_punct(const std::string& s)
+// same language as regex_punct
+bool is_punct(const boost::string_ref& s)
 {
-    return boost::regex_match(s, regex_punct);
+    if (s.empty())
+        return false;
+    for (const char c : s)
+        if (!is_punct_char(c))
+            return false;
+    return true;
 }
 
 std::string to_lower(const std::string& s)
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dytools/thread_pool.h"
+#include "dytools/data/conll.h"
+#include "dytools/data/conll_dicts.h"
+
+// Checks that build_conll_dicts builds the same vocabularies as the per-dictionary builders of conll.h
+// (ids differ: the fused builder sorts entries by frequency).
+// usage: test-conll-dicts [CONLL_PATH]
+// without argument, a random corpus with numbers, mixed case words and non-ASCII characters is used
+
+namespace
+{
+
+std::vector<dytools::ConllSentence> random_corpus()
+{
+    const std::vector<std::string> words = {
+        "The", "the", "THE", "Paris", "paris", "1984", "3.14", "1,000", "12,5.0", "*UNK*",
+        "café", "Café", "naïve", "日本", ",", ".", "--", "a1", "1a", "x"
+    };
+    const std::vector<std::string> tags = {"DET", "NOUN", "NUM", "PUNCT", "X"};
+    const std::vector<std::string> labels = {"det", "nsubj", "root", "punct", "dep"};
+
+    std::mt19937 gen(42u);
+    std::uniform_int_distribution<unsigned> length_dist(1u, 20u);
+    std::vector<dytools::ConllSentence> ret;
+    for (unsigned i = 0u ; i < 2000u ; ++i)
+    {
+        dytools::ConllSentence sentence;
+        const unsigned length = length_dist(gen);
+        for (unsigned j = 0u ; j < length ; ++j)
+            sentence.emplace_back(
+                    words[gen() % words.size()], "_", "_", tags[gen() % tags.size()], "_",
+                    (unsigned) (gen() % length), labels[gen() % labels.size()], "_", "_"
+            );
+        ret.push_back(std::move(sentence));
+    }
+    return ret;
+}
+
+template <class T>
+std::vector<T> sorted(std::vector<T> v)
+{
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+bool same_vocabulary(const dytools::Dict& a, const dytools::Dict& b, const std::string& name)
+{
+    if (a.size() != b.size() || sorted(a.id_to_word) != sorted(b.id_to_word))
+    {
+        std::cerr << name << " dictionaries differ: " << a.size() << " / " << b.size() << " entries\n";
+        return false;
+    }
+    return true;
+}
+
+bool check(const std::vector<dytools::ConllSentence>& data, const bool lowercase, const bool has_num)
+{
+    dytools::ConllDictSettings settings;
+    settings.lowercase = lowercase;
+    settings.has_num = has_num;
+    const auto fused = dytools::build_conll_dicts(data, settings, dytools::get_default_thread_pool());
+
+    const auto token_dict = dytools::build_conll_token_dict(lowercase, has_num, data.begin(), data.end());
+    const auto char_dict = dytools::build_conll_char_dict(data.begin(), data.end());
+    const auto tag_dict = dytools::build_conll_tag_dict(data.begin(), data.end());
+    const auto label_dict = dytools::build_conll_label_dict(data.begin(), data.end());
+
+    bool ok = same_vocabulary(*fused.token_dict, *token_dict, "token");
+    ok = same_vocabulary(*fused.tag_dict, *tag_dict, "tag") && ok;
+    ok = same_vocabulary(*fused.label_dict, *label_dict, "label") && ok;
+    if (sorted(fused.char_dict->id_to_code_point) != sorted(char_dict->id_to_code_point))
+    {
+        std::cerr << "character dictionaries differ: " << fused.char_dict->size() << " / " << char_dict->size() << " entries\n";
+        ok = false;
+    }
+
+    // both dictionaries normalize words the same way
+    for (const auto& sentence : data)
+        for (const auto& token : sentence)
+            if (fused.token_dict->to_string(fused.token_dict->to_id(token.word)) != token_dict->to_string(token_dict->to_id(token.word)))
+            {
+                std::cerr << "different lookup for: " << token.word << "\n";
+                return false;
+            }
+
+    std::cerr << "lowercase=" << lowercase << " has_num=" << has_num << ": " << (ok ? "ok" : "FAILED") << "\n";
+    return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<dytools::ConllSentence> data;
+    if (argc > 1)
+        dytools::read(std::string(argv[1]), data);
+    else
+        data = random_corpus();
+
+    bool ok = true;
+    for (const bool lowercase : {false, true})
+        for (const bool has_num : {false, true})
+            ok = check(data, lowercase, has_num) && ok;
+    return ok ? 0 : 1;
+}
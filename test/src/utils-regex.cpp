@@ -0,0 +1,110 @@
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "dytools/utils.h"
+
+// Checks that is_num and is_punct accept the same strings as the reference regexes,
+// on random strings built from the characters where they could disagree
+// (digits, separators, ASCII punctuation and letters, arbitrary bytes and UTF-8 sequences).
+// usage: test-utils-regex [N_STRINGS]
+
+namespace
+{
+
+const std::string interesting_chars = "0123456789.,.,-+!\"#$%&'()*/:;<=>?@[\\]^_`{|}~ aZ\t";
+
+std::string random_string(std::mt19937& gen)
+{
+    std::uniform_int_distribution<unsigned> length_dist(0u, 8u);
+    std::uniform_int_distribution<unsigned> kind_dist(0u, 9u);
+    std::uniform_int_distribution<unsigned> char_dist(0u, interesting_chars.size() - 1u);
+    std::uniform_int_distribution<unsigned> byte_dist(0u, 255u);
+    std::uniform_int_distribution<unsigned> code_point_dist(0x80u, 0x10FFFFu);
+
+    std::string ret;
+    const unsigned length = length_dist(gen);
+    for (unsigned i = 0u ; i < length ; ++i)
+    {
+        const unsigned kind = kind_dist(gen);
+        if (kind < 7u)
+            ret += interesting_chars[char_dist(gen)];
+        else if (kind < 9u)
+            ret += (char) byte_dist(gen);
+        else
+        {
+            // UTF-8 encoding of a non-ASCII code point (surrogates included, they are only bytes here)
+            const unsigned c = code_point_dist(gen);
+            if (c < 0x800u)
+            {
+                ret += (char) (0xC0u | (c >> 6u));
+                ret += (char) (0x80u | (c & 0x3Fu));
+            }
+            else if (c < 0x10000u)
+            {
+                ret += (char) (0xE0u | (c >> 12u));
+                ret += (char) (0x80u | ((c >> 6u) & 0x3Fu));
+                ret += (char) (0x80u | (c & 0x3Fu));
+            }
+            else
+            {
+                ret += (char) (0xF0u | (c >> 18u));
+                ret += (char) (0x80u | ((c >> 12u) & 0x3Fu));
+                ret += (char) (0x80u | ((c >> 6u) & 0x3Fu));
+                ret += (char) (0x80u | (c & 0x3Fu));
+            }
+        }
+    }
+    return ret;
+}
+
+std::string escape(const std::string& s)
+{
+    std::string ret;
+    const char* hex = "0123456789abcdef";
+    for (const char c : s)
+    {
+        const unsigned char u = (unsigned char) c;
+        if (u >= 32u && u < 127u && u != '\\')
+            ret += c;
+        else
+        {
+            ret += "\\x";
+            ret += hex[u >> 4u];
+            ret += hex[u & 15u];
+        }
+    }
+    return ret;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned long n_strings = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000ul);
+
+    std::mt19937 gen(42u);
+    unsigned long n_mismatches = 0ul;
+    for (unsigned long i = 0ul ; i < n_strings ; ++i)
+    {
+        const std::string s = random_string(gen);
+
+        const bool num = dytools::is_num(s);
+        const bool punct = dytools::is_punct(s);
+        const bool expected_num = boost::regex_match(s, dytools::regex_num);
+        const bool expected_punct = boost::regex_match(s, dytools::regex_punct);
+        if (num != expected_num || punct != expected_punct)
+        {
+            if (n_mismatches < 10ul)
+                std::cerr
+                    << "mismatch on \"" << escape(s) << "\":"
+                    << " is_num=" << num << " (regex: " << expected_num << ")"
+                    << " is_punct=" << punct << " (regex: " << expected_punct << ")\n";
+            ++ n_mismatches;
+        }
+    }
+
+    std::cerr << n_mismatches << " mismatches on " << n_strings << " strings" << std::endl;
+    return n_mismatches == 0ul ? 0 : 1;
+}